@@ -0,0 +1,162 @@
+/*
+ * mcu-max UCI chess interface example
+ * Benchmark
+ *
+ * (C) 2022-2024 Gissio
+ *
+ * License: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "mcu-max.h"
+
+#include "bench.h"
+
+// Openings, middlegames and endgames; mates found at the quiescence horizon
+static const char *bench_positions[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+    "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+    "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+    "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+    "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+    "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+    "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+    "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+    "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+    "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+    "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/8 b - - 3 54",
+    "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+    "2K5/p7/7P/5pR1/8/5k2/r7/8 w - - 0 1",
+    "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+    "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+    "8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w - - 0 1",
+    "8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w - - 0 1",
+    "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+    "8/3p4/p1bk3p/Pp6/1Kp1PpPp/2P2P1P/2P5/5B2 b - - 0 1",
+    "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+    "6k1/6p1/P6p/r1N5/5p2/7P/1b3PP1/4R1K1 w - - 0 1",
+    "1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1",
+    "6k1/4pp1p/3p2p1/P1pPb3/R7/1r2P1PP/3B1P2/6K1 w - - 0 1",
+    "8/3p3B/5p2/5P2/p7/PP5b/k7/6K1 w - - 0 1",
+    "k3r3/8/8/8/8/8/6P1/6RK b - - 0 1",
+    "r5rk/5p1p/5R2/4B3/8/8/7P/7K w - - 0 1",
+};
+
+#define BENCH_POSITIONS_NUM (sizeof(bench_positions) / sizeof(bench_positions[0]))
+#define BENCH_VALID_MOVES_NUM 256
+
+static uint64_t bench_get_time_ns(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+// FNV-1a
+static uint32_t bench_hash(uint32_t hash, uint32_t value)
+{
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        hash = (hash ^ (value & 0xff)) * 0x01000193;
+        value >>= 8;
+    }
+
+    return hash;
+}
+
+uint32_t bench_run(uint32_t depth_max, uint32_t node_max)
+{
+    uint64_t nodes = 0;
+    uint64_t time = 0;
+    uint32_t signature = 0x811c9dc5;
+
+    mcumax_clear_hash();
+
+    for (uint32_t i = 0; i < BENCH_POSITIONS_NUM; i++)
+    {
+        mcumax_set_fen_position(bench_positions[i]);
+
+        uint64_t start_time = bench_get_time_ns();
+        mcumax_move move = mcumax_search_best_move(node_max, depth_max);
+        time += bench_get_time_ns() - start_time;
+
+        uint32_t position_nodes = mcumax_get_node_count();
+        nodes += position_nodes;
+
+        signature = bench_hash(signature, position_nodes);
+        signature = bench_hash(signature, (move.from << 8) | move.to);
+
+        printf("info string position %u/%u nodes %u\n",
+               i + 1,
+               (uint32_t)BENCH_POSITIONS_NUM,
+               position_nodes);
+    }
+
+    uint64_t time_ms = time / 1000000;
+
+    printf("\n");
+    printf("Nodes searched: %llu\n", (unsigned long long)nodes);
+    printf("Time (ms)     : %llu\n", (unsigned long long)time_ms);
+    printf("Nodes/second  : %llu\n", (unsigned long long)(time ? nodes * 1000000000 / time : 0));
+    printf("Signature     : %08x\n", signature);
+
+    return signature;
+}
+
+uint64_t bench_run_move_generation(uint32_t iterations)
+{
+    uint64_t moves_num = 0;
+    uint64_t time = 0;
+    mcumax_move moves[BENCH_VALID_MOVES_NUM];
+
+    for (uint32_t i = 0; i < BENCH_POSITIONS_NUM; i++)
+    {
+        mcumax_set_fen_position(bench_positions[i]);
+
+        uint64_t start_time = bench_get_time_ns();
+        for (uint32_t j = 0; j < iterations; j++)
+            moves_num += mcumax_search_valid_moves(moves, BENCH_VALID_MOVES_NUM);
+        time += bench_get_time_ns() - start_time;
+    }
+
+    uint64_t lists_num = (uint64_t)iterations * BENCH_POSITIONS_NUM;
+
+    printf("Move lists    : %llu\n", (unsigned long long)lists_num);
+    printf("Moves         : %llu\n", (unsigned long long)moves_num);
+    printf("Time (ms)     : %llu\n", (unsigned long long)(time / 1000000));
+    printf("Lists/second  : %llu\n", (unsigned long long)(time ? lists_num * 1000000000 / time : 0));
+    printf("Moves/second  : %llu\n", (unsigned long long)(time ? moves_num * 1000000000 / time : 0));
+
+    return moves_num;
+}
+
+#if defined(BENCH_STANDALONE)
+
+#include <string.h>
+
+// mcu-max-bench [depth [nodes]]
+// mcu-max-bench movegen [iterations]
+int main(int argc, char *argv[])
+{
+    mcumax_init();
+
+    if ((argc > 1) && !strcmp(argv[1], "movegen"))
+        bench_run_move_generation((argc > 2) ? strtoul(argv[2], NULL, 10) : BENCH_MOVE_LISTS);
+    else
+        bench_run((argc > 1) ? strtoul(argv[1], NULL, 10) : BENCH_DEPTH,
+                  (argc > 2) ? strtoul(argv[2], NULL, 10) : BENCH_NODE_MAX);
+
+    return 0;
+}
+
+#endif
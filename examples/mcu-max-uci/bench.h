@@ -0,0 +1,42 @@
+/*
+ * mcu-max UCI chess interface example
+ * Benchmark
+ *
+ * (C) 2022-2024 Gissio
+ *
+ * License: MIT
+ */
+
+#if !defined(BENCH_H)
+#define BENCH_H
+
+#include <stdint.h>
+
+#define BENCH_DEPTH 5
+#define BENCH_NODE_MAX UINT32_MAX
+#define BENCH_MOVE_LISTS 20000
+
+/**
+ * @brief Searches the benchmark positions with a cleared hash table and prints
+ * total nodes, time, nodes per second and a signature of the node counts and
+ * best moves. The signature only changes when search behaviour changes.
+ *
+ * @param depth_max The maximum depth to search.
+ * @param node_max The maximum number of nodes to search per position.
+ *
+ * @return The signature.
+ */
+uint32_t bench_run(uint32_t depth_max, uint32_t node_max);
+
+/**
+ * @brief Lists the valid moves of each benchmark position repeatedly and
+ * prints move lists and moves per second: the move generation and legality
+ * (attack detection) hot path, without search.
+ *
+ * @param iterations The number of move lists per position.
+ *
+ * @return The number of moves listed.
+ */
+uint64_t bench_run_move_generation(uint32_t iterations);
+
+#endif
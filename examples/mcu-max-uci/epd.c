@@ -0,0 +1,441 @@
+/*
+ * mcu-max UCI chess interface example
+ * EPD test suite runner
+ *
+ * (C) 2022-2024 Gissio
+ *
+ * License: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "epd.h"
+#include "pgn.h"
+
+#define EPD_LINE_SIZE 1024
+#define EPD_MOVES_MAX 8
+#define EPD_VALID_MOVES_MAX 256
+#define EPD_NODE_BUDGET 256 // Nodes between iteration checks
+
+static uint64_t epd_get_time_ns(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+static bool epd_is_move_in(mcumax_move move, const mcumax_move *moves, uint32_t moves_num)
+{
+    for (uint32_t i = 0; i < moves_num; i++)
+    {
+        if ((moves[i].from == move.from) &&
+            (moves[i].to == move.to))
+            return true;
+    }
+
+    return false;
+}
+
+void epd_solve(const char *line, const epd_limits *limits, epd_result *result)
+{
+    memset(result, 0, sizeof(*result));
+    result->move = MCUMAX_MOVE_INVALID;
+
+    // Position: board, side, castling, e.p. fields
+    char buffer[EPD_LINE_SIZE];
+    strncpy(buffer, line, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = '\0';
+
+    char fen[MCUMAX_FEN_SIZE] = "";
+    char *p = buffer;
+
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        p += strspn(p, " \t");
+        size_t length = strcspn(p, " \t\r\n");
+
+        if (!length ||
+            ((strlen(fen) + length + 2) >= sizeof(fen)))
+            return;
+
+        strncat(fen, p, length);
+        strcat(fen, " ");
+        p += length;
+    }
+
+    mcumax_set_fen_position(fen);
+
+    mcumax_move valid_moves[EPD_VALID_MOVES_MAX];
+    uint32_t valid_moves_num = mcumax_search_valid_moves(valid_moves, EPD_VALID_MOVES_MAX);
+
+    // Opcodes: "bm Qxh7+ Rd8; id "WAC.001";"
+    mcumax_move best_moves[EPD_MOVES_MAX];
+    uint32_t best_moves_num = 0;
+    mcumax_move avoid_moves[EPD_MOVES_MAX];
+    uint32_t avoid_moves_num = 0;
+
+    for (char *opcode = strtok(p, ";"); opcode; opcode = strtok(NULL, ";"))
+    {
+        opcode += strspn(opcode, " \t\r\n");
+
+        bool best = !strncmp(opcode, "bm ", 3);
+        bool avoid = !strncmp(opcode, "am ", 3);
+
+        if (!strncmp(opcode, "id ", 3))
+        {
+            char *id = opcode + 3 + strspn(opcode + 3, " \t\"");
+
+            strncpy(result->id, id, EPD_ID_SIZE - 1);
+            result->id[strcspn(result->id, "\"\r\n")] = '\0';
+        }
+        else if (best || avoid)
+        {
+            char *operands = opcode + 3;
+
+            for (char *operand = operands;
+                 *(operand += strspn(operand, " \t")) != '\0';
+                 operand += strcspn(operand, " \t"))
+            {
+                char san[16];
+                size_t length = strcspn(operand, " \t\r\n");
+                mcumax_move move;
+
+                if (!length || (length >= sizeof(san)))
+                    break;
+
+                memcpy(san, operand, length);
+                san[length] = '\0';
+
+                if (!pgn_get_san_move(san, valid_moves, valid_moves_num, &move))
+                    return;
+
+                if (best && (best_moves_num < EPD_MOVES_MAX))
+                    best_moves[best_moves_num++] = move;
+                else if (avoid && (avoid_moves_num < EPD_MOVES_MAX))
+                    avoid_moves[avoid_moves_num++] = move;
+            }
+        }
+    }
+
+    if (!best_moves_num && !avoid_moves_num)
+        return;
+
+    result->valid = true;
+
+    // Search, checking the best move whenever an iteration completes
+    mcumax_clear_hash();
+    mcumax_search_begin(limits->node_max, limits->depth_max);
+
+    uint64_t start_time = epd_get_time_ns();
+    uint32_t depth = 0;
+    bool stopped = false;
+    bool done;
+
+    do
+    {
+        done = mcumax_search_step(EPD_NODE_BUDGET);
+
+        uint64_t time = epd_get_time_ns() - start_time;
+
+        if (limits->time_max_ms &&
+            !stopped &&
+            (time >= (uint64_t)limits->time_max_ms * 1000000))
+        {
+            // Unwinds within a few steps
+            mcumax_stop_search();
+            stopped = true;
+        }
+
+        if (done ||
+            (mcumax_get_search_depth() != depth))
+        {
+            mcumax_move move = mcumax_search_result();
+
+            bool correct = (move.from != MCUMAX_SQUARE_INVALID) &&
+                           (!best_moves_num ||
+                            epd_is_move_in(move, best_moves, best_moves_num)) &&
+                           !epd_is_move_in(move, avoid_moves, avoid_moves_num);
+
+            depth = mcumax_get_search_depth();
+
+            if (!correct)
+                result->solved = false;
+            else if (!result->solved)
+            {
+                result->solved = true;
+                result->depth = depth;
+                result->nodes = mcumax_get_node_count();
+                result->time_ns = time;
+            }
+
+            result->move = move;
+        }
+
+        result->nodes_total = mcumax_get_node_count();
+        result->time_total_ns = time;
+    } while (!done);
+}
+
+#if defined(EPD_STANDALONE)
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+static int epd_compare_uint64(const void *a, const void *b)
+{
+    uint64_t value_a = *(const uint64_t *)a;
+    uint64_t value_b = *(const uint64_t *)b;
+
+    return (value_a > value_b) - (value_a < value_b);
+}
+
+// Prints median, 90th percentile and maximum
+static void epd_print_distribution(const char *name, uint64_t *values, uint32_t values_num, uint64_t divisor)
+{
+    qsort(values, values_num, sizeof(uint64_t), epd_compare_uint64);
+
+    printf("%s: median %llu, 90%% %llu, max %llu\n",
+           name,
+           (unsigned long long)(values_num ? values[values_num / 2] / divisor : 0),
+           (unsigned long long)(values_num ? values[values_num * 9 / 10] / divisor : 0),
+           (unsigned long long)(values_num ? values[values_num - 1] / divisor : 0));
+}
+
+static void epd_print_result(const epd_result *result, uint32_t index)
+{
+    char label[EPD_ID_SIZE];
+
+    if (result->id[0])
+        strcpy(label, result->id);
+    else
+        snprintf(label, sizeof(label), "#%u", index + 1);
+
+    printf("%-20s ", label);
+
+    if (!result->valid)
+    {
+        printf("invalid\n");
+
+        return;
+    }
+
+    printf("%-6s", result->solved ? "solved" : "failed");
+
+    if (result->move.from == MCUMAX_SQUARE_INVALID)
+        printf(" (none)");
+    else
+        printf(" %c%c%c%c",
+               'a' + (result->move.from & 0x7),
+               '8' - (result->move.from >> 4),
+               'a' + (result->move.to & 0x7),
+               '8' - (result->move.to >> 4));
+
+    if (result->solved)
+        printf(" depth %2u nodes %10u time %8llu ms",
+               result->depth,
+               result->nodes,
+               (unsigned long long)(result->time_ns / 1000000));
+
+    printf("\n");
+}
+
+// mcu-max-epd [-j workers] [-n nodes] [-d depth] [-t ms] file.epd
+int main(int argc, char *argv[])
+{
+    uint32_t workers_num = 1;
+    epd_limits limits = {1000000, 30, 0};
+
+    int option;
+    while ((option = getopt(argc, argv, "j:n:d:t:")) != -1)
+    {
+        switch (option)
+        {
+        case 'j':
+            workers_num = strtoul(optarg, NULL, 10);
+            if (workers_num < 1)
+                workers_num = 1;
+
+            break;
+
+        case 'n':
+            limits.node_max = strtoul(optarg, NULL, 10);
+
+            break;
+
+        case 'd':
+            limits.depth_max = strtoul(optarg, NULL, 10);
+
+            break;
+
+        case 't':
+            limits.time_max_ms = strtoul(optarg, NULL, 10);
+
+            break;
+
+        default:
+            optind = argc;
+
+            break;
+        }
+    }
+
+    if (optind != (argc - 1))
+    {
+        fprintf(stderr, "usage: %s [-j workers] [-n nodes] [-d depth] [-t ms] file.epd\n", argv[0]);
+
+        return 1;
+    }
+
+    // Read positions
+    FILE *file = fopen(argv[optind], "r");
+    if (!file)
+    {
+        perror(argv[optind]);
+
+        return 1;
+    }
+
+    char **lines = NULL;
+    uint32_t lines_num = 0;
+    char line[EPD_LINE_SIZE];
+
+    while (fgets(line, sizeof(line), file))
+    {
+        if (strspn(line, " \t\r\n") == strlen(line))
+            continue;
+
+        lines = realloc(lines, (lines_num + 1) * sizeof(char *));
+        lines[lines_num++] = strdup(line);
+    }
+
+    fclose(file);
+
+    epd_result *results = calloc(lines_num ? lines_num : 1, sizeof(epd_result));
+
+    if (workers_num > lines_num)
+        workers_num = lines_num ? lines_num : 1;
+
+    // One process, and so one engine state, per worker; positions interleaved
+    int pipes[workers_num][2];
+    pid_t pids[workers_num];
+
+    fflush(stdout);
+
+    for (uint32_t i = 0; i < workers_num; i++)
+    {
+        if (pipe(pipes[i]) ||
+            ((pids[i] = fork()) < 0))
+        {
+            perror("fork");
+
+            return 1;
+        }
+
+        if (!pids[i])
+        {
+            close(pipes[i][0]);
+
+            mcumax_init();
+
+            for (uint32_t j = i; j < lines_num; j += workers_num)
+            {
+                epd_result result;
+                epd_solve(lines[j], &limits, &result);
+
+                if (write(pipes[i][1], &result, sizeof(result)) != sizeof(result))
+                    _exit(1);
+            }
+
+            _exit(0);
+        }
+
+        close(pipes[i][1]);
+    }
+
+    bool ok = true;
+
+    for (uint32_t i = 0; i < workers_num; i++)
+    {
+        for (uint32_t j = i; j < lines_num; j += workers_num)
+        {
+            if (read(pipes[i][0], &results[j], sizeof(epd_result)) != sizeof(epd_result))
+            {
+                ok = false;
+
+                break;
+            }
+        }
+
+        close(pipes[i][0]);
+
+        int status;
+        if ((waitpid(pids[i], &status, 0) < 0) ||
+            !WIFEXITED(status) ||
+            WEXITSTATUS(status))
+            ok = false;
+    }
+
+    if (!ok)
+    {
+        fprintf(stderr, "%s: worker failed\n", argv[0]);
+
+        return 1;
+    }
+
+    // Report
+    uint32_t solved_num = 0;
+    uint32_t valid_num = 0;
+    uint64_t nodes_total = 0;
+    uint64_t time_total = 0;
+    uint64_t *nodes = calloc(lines_num ? lines_num : 1, sizeof(uint64_t));
+    uint64_t *times = calloc(lines_num ? lines_num : 1, sizeof(uint64_t));
+
+    for (uint32_t i = 0; i < lines_num; i++)
+    {
+        epd_result *result = &results[i];
+
+        epd_print_result(result, i);
+
+        if (!result->valid)
+            continue;
+
+        valid_num++;
+        nodes_total += result->nodes_total;
+        time_total += result->time_total_ns;
+
+        if (result->solved)
+        {
+            nodes[solved_num] = result->nodes;
+            times[solved_num] = result->time_ns;
+            solved_num++;
+        }
+    }
+
+    printf("\n");
+    printf("Solved        : %u/%u\n", solved_num, valid_num);
+    printf("Nodes searched: %llu\n", (unsigned long long)nodes_total);
+    printf("Time (ms)     : %llu\n", (unsigned long long)(time_total / 1000000));
+
+    // Time to solution: solved within 10^k nodes
+    printf("Solved within :");
+    for (uint64_t limit = 1000; limit <= 100000000; limit *= 10)
+    {
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < solved_num; i++)
+            count += (nodes[i] <= limit);
+
+        printf(" %lluk: %u", (unsigned long long)(limit / 1000), count);
+    }
+    printf("\n");
+
+    epd_print_distribution("Nodes to solution", nodes, solved_num, 1);
+    epd_print_distribution("Time to solution (ms)", times, solved_num, 1000000);
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * mcu-max UCI chess interface example
+ * EPD test suite runner
+ *
+ * (C) 2022-2024 Gissio
+ *
+ * License: MIT
+ */
+
+#if !defined(EPD_H)
+#define EPD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mcu-max.h"
+
+#define EPD_ID_SIZE 64
+
+typedef struct
+{
+    uint32_t node_max;
+    uint32_t depth_max;
+    uint32_t time_max_ms; // 0 for none
+} epd_limits;
+
+typedef struct
+{
+    char id[EPD_ID_SIZE];
+    bool valid; // Position and bm/am moves read
+    bool solved;
+    mcumax_move move; // Best move found
+
+    // Time to solution: iteration from which the best move stayed correct
+    uint32_t depth;
+    uint32_t nodes;
+    uint64_t time_ns;
+
+    uint32_t nodes_total;
+    uint64_t time_total_ns;
+} epd_result;
+
+/**
+ * @brief Searches the position of an EPD line with a cleared hash table and
+ * checks the best move of each iteration against its "bm" (best moves) or
+ * "am" (avoid moves) opcodes.
+ *
+ * @param line The EPD line.
+ * @param limits The search limits.
+ * @param result The result.
+ */
+void epd_solve(const char *line, const epd_limits *limits, epd_result *result);
+
+#endif
@@ -6,13 +6,55 @@
  * License: MIT
  */
 
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "mcu-max.h"
 
+#include "bench.h"
+#ifdef MCUMAX_TRACE
+#include "trace.h"
+#endif
+
 #define MAIN_VALID_MOVES_NUM 512
+#define MAIN_MULTIPV_MAX 16
+#define MAIN_PAWN_VALUE 74
+#define MAIN_NODE_MAX 1
+#define MAIN_DEPTH_MAX 30
+#define MAIN_TRACE_RECORDS_NUM 0x100000
+#define MAIN_MATE_ARENA_SIZE 0x4000000
+#define MAIN_MATE_LINE_SIZE 64
+#define MAIN_MOVES_TO_GO 30           // Moves to the time control, if not given
+#define MAIN_TIME_MARGIN_MS 50        // Reserve for move transmission
+#define MAIN_TIME_CHECK_INTERVAL 1024 // Callbacks between clock reads
+#define MAIN_SIDE_BLACK 0x10          // mcumax_get_current_side()
+
+char hash_file[256];
+uint32_t multipv = 1;
+
+#ifdef MCUMAX_TRACE
+// Search trace: saved after each search
+char trace_file[256];
+mcumax_trace_record *trace_buffer;
+#endif
+
+// Search worker: searches while the input loop keeps reading commands
+pthread_t search_thread;
+pthread_mutex_t search_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t search_cond = PTHREAD_COND_INITIALIZER;
+bool search_running;
+atomic_bool search_stop;
+bool search_infinite;
+uint64_t search_deadline_ms; // 0 for none
+uint32_t search_callback_count;
+uint32_t search_node_max;
+uint32_t search_depth_max;
+uint32_t search_mate_moves; // go mate: proof-number search first
+mcumax_move search_moves[MAIN_VALID_MOVES_NUM];
 
 void print_board()
 {
@@ -76,6 +118,166 @@ void print_move(mcumax_move move)
     }
 }
 
+uint64_t get_time_ms()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t)time.tv_sec * 1000 + time.tv_nsec / 1000000;
+}
+
+void search_callback(void *userdata)
+{
+    (void)userdata;
+
+    if (atomic_load(&search_stop) ||
+        (search_deadline_ms &&
+         !(++search_callback_count % MAIN_TIME_CHECK_INTERVAL) &&
+         (get_time_ms() >= search_deadline_ms)))
+        mcumax_stop_search();
+}
+
+// Returns the time for this move: movetime, or a share of the side's clock
+uint32_t get_move_time(uint32_t move_time,
+                       uint32_t time,
+                       uint32_t increment,
+                       uint32_t moves_to_go)
+{
+    if (move_time)
+        return move_time;
+
+    uint32_t time_safe = (time > MAIN_TIME_MARGIN_MS) ? time - MAIN_TIME_MARGIN_MS : 0;
+    uint32_t time_max = time / (moves_to_go ? moves_to_go : MAIN_MOVES_TO_GO) + increment;
+
+    return (time_max < time_safe) ? time_max : time_safe;
+}
+
+void *search_worker(void *arg)
+{
+    (void)arg;
+
+    mcumax_move move = MCUMAX_MOVE_INVALID;
+
+#ifdef MCUMAX_TRACE
+    if (trace_file[0])
+        mcumax_set_trace_buffer(trace_buffer, MAIN_TRACE_RECORDS_NUM);
+#endif
+
+    if (search_mate_moves)
+    {
+        mcumax_move line[MAIN_MATE_LINE_SIZE];
+        void *arena = malloc(MAIN_MATE_ARENA_SIZE);
+        uint32_t result = arena ? mcumax_search_mate(line,
+                                                     MAIN_MATE_LINE_SIZE,
+                                                     search_mate_moves,
+                                                     search_node_max,
+                                                     arena,
+                                                     MAIN_MATE_ARENA_SIZE)
+                                : MCUMAX_MATE_UNKNOWN;
+        free(arena);
+
+        flockfile(stdout);
+        if (result == MCUMAX_MATE_FOUND)
+        {
+            uint32_t line_num = 0;
+            while ((line_num < MAIN_MATE_LINE_SIZE) &&
+                   (line[line_num].from != MCUMAX_SQUARE_INVALID))
+                line_num++;
+
+            printf("info nodes %u score mate %u pv", mcumax_get_node_count(), (line_num + 1) / 2);
+            for (uint32_t i = 0; i < line_num; i++)
+            {
+                printf(" ");
+                print_move(line[i]);
+            }
+            printf("\n");
+
+            move = line[0];
+        }
+        else
+            printf("info string %s\n",
+                   (result == MCUMAX_MATE_NONE) ? "no mate" : "no mate found within limits");
+        fflush(stdout);
+        funlockfile(stdout);
+    }
+
+    // No mate: best move
+    if (move.from == MCUMAX_SQUARE_INVALID)
+    {
+        if (multipv > 1)
+        {
+            mcumax_scored_move lines[MAIN_MULTIPV_MAX];
+            uint32_t lines_num = mcumax_search_best_moves(lines,
+                                                          multipv,
+                                                          search_node_max,
+                                                          search_depth_max);
+
+            flockfile(stdout);
+            for (uint32_t i = 0; i < lines_num; i++)
+            {
+                printf("info multipv %u depth %u score cp %d pv ",
+                       i + 1,
+                       lines[i].depth,
+                       lines[i].score * 100 / MAIN_PAWN_VALUE);
+                print_move(lines[i].move);
+                printf("\n");
+            }
+            fflush(stdout);
+            funlockfile(stdout);
+
+            move = mcumax_search_result();
+        }
+        else
+            move = mcumax_search_best_move(search_node_max, search_depth_max);
+    }
+
+#ifdef MCUMAX_TRACE
+    if (trace_file[0] &&
+        !trace_save(trace_file, trace_buffer, MAIN_TRACE_RECORDS_NUM))
+        printf("info string trace file not saved\n");
+#endif
+
+    // Stopped before the first iteration completed: any valid move
+    mcumax_set_callback(NULL, NULL);
+
+    if (move.from == MCUMAX_SQUARE_INVALID)
+        mcumax_search_valid_moves(&move, 1);
+
+    mcumax_play_move(move);
+
+    mcumax_set_callback(search_callback, NULL);
+
+    // go infinite: report only when stopped
+    pthread_mutex_lock(&search_mutex);
+    while (search_infinite && !atomic_load(&search_stop))
+        pthread_cond_wait(&search_cond, &search_mutex);
+    pthread_mutex_unlock(&search_mutex);
+
+    flockfile(stdout);
+    printf("bestmove ");
+    print_move(move);
+    printf("\n");
+    fflush(stdout);
+    funlockfile(stdout);
+
+    return NULL;
+}
+
+void stop_search()
+{
+    if (!search_running)
+        return;
+
+    pthread_mutex_lock(&search_mutex);
+    atomic_store(&search_stop, true);
+    pthread_cond_signal(&search_cond);
+    pthread_mutex_unlock(&search_mutex);
+
+    pthread_join(search_thread, NULL);
+
+    search_running = false;
+}
+
 bool send_uci_command(char *line)
 {
     char *token = strtok(line, " \n");
@@ -83,15 +285,78 @@ bool send_uci_command(char *line)
     if (!token)
         return false;
 
+    // Commands other than these wait for the search to finish
+    if (strcmp(token, "isready") &&
+        strcmp(token, "stop") &&
+        strcmp(token, "quit") &&
+        search_running)
+    {
+        if (search_infinite)
+            stop_search();
+        else
+        {
+            pthread_join(search_thread, NULL);
+            search_running = false;
+        }
+    }
+
     if (!strcmp(token, "uci"))
     {
         printf("id name " MCUMAX_ID "\n");
         printf("id author " MCUMAX_AUTHOR "\n");
+        printf("option name HashFile type string default <empty>\n");
+        printf("option name MultiPV type spin default 1 min 1 max %d\n", MAIN_MULTIPV_MAX);
+#ifdef MCUMAX_TRACE
+        printf("option name TraceFile type string default <empty>\n");
+#endif
         printf("uciok\n");
     }
     else if (!strcmp(token, "uci") ||
              !strcmp(token, "ucinewgame"))
         mcumax_init();
+    else if (!strcmp(token, "setoption"))
+    {
+        // setoption name HashFile value <path>: load now, save on quit
+        strtok(NULL, " \n");
+        char *name = strtok(NULL, " \n");
+        strtok(NULL, " \n");
+        char *value = strtok(NULL, "\n");
+
+        if (name && !strcmp(name, "HashFile"))
+        {
+            strcpy(hash_file, "");
+            if (value && strcmp(value, "<empty>"))
+                strncat(hash_file, value, sizeof(hash_file) - 1);
+
+            if (hash_file[0])
+                printf("info string hash file %s\n",
+                       mcumax_load_hash(hash_file) ? "loaded" : "not loaded");
+        }
+#ifdef MCUMAX_TRACE
+        else if (name && !strcmp(name, "TraceFile"))
+        {
+            // setoption name TraceFile value <path>: save trace of each search
+            strcpy(trace_file, "");
+            if (value && strcmp(value, "<empty>"))
+                strncat(trace_file, value, sizeof(trace_file) - 1);
+
+            if (trace_file[0] && !trace_buffer)
+                trace_buffer = malloc(MAIN_TRACE_RECORDS_NUM * sizeof(mcumax_trace_record));
+            if (!trace_buffer)
+                strcpy(trace_file, "");
+
+            mcumax_set_trace_buffer(trace_file[0] ? trace_buffer : NULL, MAIN_TRACE_RECORDS_NUM);
+        }
+#endif
+        else if (name && value && !strcmp(name, "MultiPV"))
+        {
+            multipv = strtoul(value, NULL, 10);
+            if (multipv < 1)
+                multipv = 1;
+            else if (multipv > MAIN_MULTIPV_MAX)
+                multipv = MAIN_MULTIPV_MAX;
+        }
+    }
     else if (!strcmp(token, "isready"))
         printf("readyok\n");
     else if (!strcmp(token, "d"))
@@ -149,15 +414,119 @@ bool send_uci_command(char *line)
     }
     else if (!strcmp(token, "go"))
     {
-        mcumax_move move = mcumax_search_best_move(1, 30);
-        mcumax_play_move(move);
+        uint32_t search_moves_num = 0;
+        bool search_moves_parsing = false;
+        uint32_t times[2] = {0, 0}; // White, black
+        uint32_t increments[2] = {0, 0};
+        uint32_t moves_to_go = 0;
+        uint32_t move_time = 0;
 
-        printf("bestmove ");
-        print_move(move);
-        printf("\n");
+        search_infinite = false;
+        search_node_max = MAIN_NODE_MAX;
+        search_depth_max = MAIN_DEPTH_MAX;
+        search_mate_moves = 0;
+
+        while ((token = strtok(NULL, " \n")))
+        {
+            if (!strcmp(token, "searchmoves"))
+                search_moves_parsing = true;
+            else if (!strcmp(token, "infinite"))
+            {
+                search_infinite = true;
+                search_node_max = UINT32_MAX;
+            }
+            else if (!strcmp(token, "nodes") &&
+                     (token = strtok(NULL, " \n")))
+                search_node_max = strtoul(token, NULL, 10);
+            else if (!strcmp(token, "wtime") ||
+                     !strcmp(token, "btime") ||
+                     !strcmp(token, "winc") ||
+                     !strcmp(token, "binc"))
+            {
+                // Clock of white or black: time left or increment
+                bool black = (token[0] == 'b');
+                uint32_t *value = strcmp(token + 1, "time") ? &increments[black]
+                                                            : &times[black];
+
+                if ((token = strtok(NULL, " \n")))
+                    *value = strtoul(token, NULL, 10);
+                search_node_max = UINT32_MAX;
+            }
+            else if (!strcmp(token, "movestogo") &&
+                     (token = strtok(NULL, " \n")))
+                moves_to_go = strtoul(token, NULL, 10);
+            else if (!strcmp(token, "movetime") &&
+                     (token = strtok(NULL, " \n")))
+            {
+                move_time = strtoul(token, NULL, 10);
+                search_node_max = UINT32_MAX;
+            }
+            else if (!strcmp(token, "depth") &&
+                     (token = strtok(NULL, " \n")))
+            {
+                search_depth_max = strtoul(token, NULL, 10);
+                search_node_max = UINT32_MAX;
+            }
+            else if (!strcmp(token, "mate") &&
+                     (token = strtok(NULL, " \n")))
+            {
+                search_mate_moves = strtoul(token, NULL, 10);
+                search_node_max = UINT32_MAX;
+                search_depth_max = 2 * search_mate_moves;
+            }
+            else if (search_moves_parsing &&
+                     is_move_valid(token) &&
+                     (search_moves_num < MAIN_VALID_MOVES_NUM))
+                search_moves[search_moves_num++] = (mcumax_move){
+                    get_square(token + 0),
+                    get_square(token + 2),
+                };
+            else
+                search_moves_parsing = false;
+        }
+
+        if (search_moves_num)
+            mcumax_set_search_moves(search_moves, search_moves_num);
+
+        // Time limit, enforced by the search callback
+        bool black = (mcumax_get_current_side() == MAIN_SIDE_BLACK);
+
+        search_deadline_ms = 0;
+        search_callback_count = 0;
+
+        if (!search_infinite &&
+            (move_time || times[black]))
+            search_deadline_ms = get_time_ms() +
+                                 get_move_time(move_time,
+                                               times[black],
+                                               increments[black],
+                                               moves_to_go);
+
+        atomic_store(&search_stop, false);
+        search_running = !pthread_create(&search_thread, NULL, search_worker, NULL);
+    }
+    else if (!strcmp(token, "stop"))
+        stop_search();
+    else if (!strcmp(token, "bench"))
+    {
+        // bench [depth [nodes]]
+        char *depth = strtok(NULL, " \n");
+        char *nodes = depth ? strtok(NULL, " \n") : NULL;
+
+        atomic_store(&search_stop, false);
+        search_deadline_ms = 0;
+        bench_run(depth ? strtoul(depth, NULL, 10) : BENCH_DEPTH,
+                  nodes ? strtoul(nodes, NULL, 10) : BENCH_NODE_MAX);
     }
     else if (!strcmp(token, "quit"))
+    {
+        stop_search();
+
+        if (hash_file[0] && !mcumax_save_hash(hash_file))
+            printf("info string hash file not saved\n");
+
         return true;
+    }
     else
         printf("Unknown command: %s\n", token);
 
@@ -167,13 +536,15 @@ bool send_uci_command(char *line)
 int main()
 {
     mcumax_init();
+    mcumax_set_callback(search_callback, NULL);
 
     while (true)
     {
         fflush(stdout);
 
         char line[65536];
-        fgets(line, sizeof(line), stdin);
+        if (!fgets(line, sizeof(line), stdin))
+            strcpy(line, "quit");
 
         if (send_uci_command(line))
             break;
@@ -0,0 +1,777 @@
+/*
+ * mcu-max UCI chess interface example
+ * PGN reader
+ *
+ * (C) 2022-2024 Gissio
+ *
+ * License: MIT
+ */
+
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcu-max.h"
+
+#include "pgn.h"
+
+#define PGN_BUFFER_SIZE 0x10000
+#define PGN_TOKEN_SIZE 256
+
+#define PGN_SIDE_BLACK 0x10 // mcumax_get_current_side()
+
+enum pgn_state
+{
+    PGN_BETWEEN_GAMES,
+    PGN_TAGS,
+    PGN_MOVES,
+};
+
+static struct
+{
+    FILE *file;
+    uint64_t offset; // Of next char
+    size_t buffer_index;
+    size_t buffer_size;
+    char buffer[PGN_BUFFER_SIZE];
+} pgn_reader;
+
+static const char pgn_piece_chars[] = "??PNKBRQ";
+
+static int pgn_getc(void)
+{
+    if (pgn_reader.buffer_index == pgn_reader.buffer_size)
+    {
+        pgn_reader.buffer_index = 0;
+        pgn_reader.buffer_size = fread(pgn_reader.buffer, 1, PGN_BUFFER_SIZE, pgn_reader.file);
+
+        if (!pgn_reader.buffer_size)
+            return EOF;
+    }
+
+    pgn_reader.offset++;
+
+    return (unsigned char)pgn_reader.buffer[pgn_reader.buffer_index++];
+}
+
+// Reads the rest of a line into buffer (truncated), without the newline
+static int pgn_read_line(char *buffer, size_t buffer_size)
+{
+    size_t length = 0;
+    int c;
+
+    while (((c = pgn_getc()) != EOF) && (c != '\n'))
+    {
+        if (length < (buffer_size - 1))
+            buffer[length++] = c;
+    }
+
+    buffer[length] = '\0';
+
+    return c;
+}
+
+// FNV-1a of board, side, castling and e.p. fields
+static uint64_t pgn_get_key(const char *fen)
+{
+    uint64_t key = 0xcbf29ce484222325;
+    uint32_t spaces = 0;
+
+    for (; *fen && ((*fen != ' ') || (++spaces < 4)); fen++)
+        key = (key ^ (uint8_t)*fen) * 0x100000001b3;
+
+    return key;
+}
+
+// Returns true if piece type can move from square_from to square_to on an
+// empty path; legality is left to mcumax_play_move()
+static bool pgn_is_reachable(uint8_t type, mcumax_square square_from, mcumax_square square_to)
+{
+    int32_t dx = (square_to & 0x7) - (square_from & 0x7);
+    int32_t dy = (square_to >> 4) - (square_from >> 4);
+    int32_t dx_abs = (dx < 0) ? -dx : dx;
+    int32_t dy_abs = (dy < 0) ? -dy : dy;
+
+    switch (type)
+    {
+    case MCUMAX_PAWN_UPSTREAM:
+    case MCUMAX_PAWN_DOWNSTREAM:
+    {
+        int32_t direction = (type == MCUMAX_PAWN_UPSTREAM) ? -1 : 1;
+
+        // Double step from start rank
+        if (!dx &&
+            (dy == 2 * direction))
+            return ((square_from >> 4) == ((direction < 0) ? 6 : 1)) &&
+                   ((mcumax_get_piece(square_from + 16 * direction) & 0x7) == MCUMAX_EMPTY);
+
+        return (dx_abs <= 1) && (dy == direction);
+    }
+
+    case MCUMAX_KNIGHT:
+        return ((dx_abs == 1) && (dy_abs == 2)) ||
+               ((dx_abs == 2) && (dy_abs == 1));
+
+    case MCUMAX_KING:
+        // Castling is written as a two-square king move
+        return ((dx_abs <= 1) && (dy_abs <= 1)) ||
+               ((dx_abs == 2) && !dy);
+
+    default:
+        if (((type == MCUMAX_BISHOP) && (dx_abs != dy_abs)) ||
+            ((type == MCUMAX_ROOK) && dx && dy) ||
+            ((type == MCUMAX_QUEEN) && (dx_abs != dy_abs) && dx && dy))
+            return false;
+
+        int32_t step = ((dx > 0) - (dx < 0)) + 16 * ((dy > 0) - (dy < 0));
+
+        for (mcumax_square square = square_from + step; square != square_to; square += step)
+        {
+            if ((mcumax_get_piece(square) & 0x7) != MCUMAX_EMPTY)
+                return false;
+        }
+
+        return true;
+    }
+}
+
+// Plays a move, writes it in UCI notation
+static bool pgn_play(mcumax_square square_from, mcumax_square square_to, char *uci)
+{
+    uint8_t type = mcumax_get_piece(square_from) & 0x7;
+
+    if (!mcumax_play_move((mcumax_move){square_from, square_to}))
+        return false;
+
+    *uci++ = 'a' + (square_from & 0x7);
+    *uci++ = '8' - (square_from >> 4);
+    *uci++ = 'a' + (square_to & 0x7);
+    *uci++ = '8' - (square_to >> 4);
+
+    // Promotion: always to queen
+    if ((type < MCUMAX_KNIGHT) &&
+        (((square_to >> 4) == 0) || ((square_to >> 4) == 7)))
+        *uci++ = 'q';
+
+    *uci = '\0';
+
+    return true;
+}
+
+// SAN move: piece type, destination, origin file and row (-1: any)
+struct pgn_san
+{
+    uint8_t type;
+    mcumax_square square_to;
+    int32_t file_from;
+    int32_t row_from;
+};
+
+static bool pgn_parse_san(const char *san, struct pgn_san *move)
+{
+    char buffer[PGN_TOKEN_SIZE];
+    size_t length = strlen(san);
+
+    // Check, mate, annotation suffixes
+    while (length && strchr("+#!?", san[length - 1]))
+        length--;
+
+    if (length >= sizeof(buffer))
+        return false;
+
+    memcpy(buffer, san, length);
+    buffer[length] = '\0';
+
+    bool black = (mcumax_get_current_side() == PGN_SIDE_BLACK);
+
+    // Castling: king moves two squares
+    move->file_from = 4;
+    move->row_from = black ? 0 : 7;
+    move->type = MCUMAX_KING;
+
+    if (!strcmp(buffer, "O-O") || !strcmp(buffer, "0-0"))
+    {
+        move->square_to = 16 * move->row_from + 6;
+
+        return true;
+    }
+
+    if (!strcmp(buffer, "O-O-O") || !strcmp(buffer, "0-0-0"))
+    {
+        move->square_to = 16 * move->row_from + 2;
+
+        return true;
+    }
+
+    // Piece
+    const char *p = buffer;
+    move->type = black ? MCUMAX_PAWN_DOWNSTREAM : MCUMAX_PAWN_UPSTREAM;
+
+    if (*p && (*p != 'P') && strchr(pgn_piece_chars + 3, *p))
+        move->type = strchr(pgn_piece_chars, *p++) - pgn_piece_chars;
+
+    // Promotion (underpromotion is not supported)
+    length = strlen(p);
+
+    if (length && strchr("NBRQ", p[length - 1]))
+    {
+        if (p[length - 1] != 'Q')
+            return false;
+
+        length--;
+        if (length && (p[length - 1] == '='))
+            length--;
+    }
+
+    // Destination square
+    if ((length < 2) ||
+        (p[length - 2] < 'a') || (p[length - 2] > 'h') ||
+        (p[length - 1] < '1') || (p[length - 1] > '8'))
+        return false;
+
+    move->square_to = (p[length - 2] - 'a') + 16 * ('8' - p[length - 1]);
+    length -= 2;
+
+    // Disambiguation, capture
+    move->file_from = -1;
+    move->row_from = -1;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        if ((p[i] >= 'a') && (p[i] <= 'h'))
+            move->file_from = p[i] - 'a';
+        else if ((p[i] >= '1') && (p[i] <= '8'))
+            move->row_from = '8' - p[i];
+        else if ((p[i] != 'x') && (p[i] != ':') && (p[i] != '-'))
+            return false;
+    }
+
+    // Pawn pushes stay on the file
+    if ((move->type < MCUMAX_KNIGHT) &&
+        (move->file_from < 0))
+        move->file_from = move->square_to & 0x7;
+
+    return true;
+}
+
+// Returns true if a SAN move can start at a square
+static bool pgn_is_san_origin(const struct pgn_san *move, mcumax_square square_from)
+{
+    mcumax_piece piece = mcumax_get_piece(square_from);
+    bool black = (mcumax_get_current_side() == PGN_SIDE_BLACK);
+
+    return ((piece & 0x7) == move->type) &&
+           (!(piece & MCUMAX_BLACK) != black) &&
+           ((move->file_from < 0) || ((square_from & 0x7) == move->file_from)) &&
+           ((move->row_from < 0) || ((square_from >> 4) == move->row_from)) &&
+           pgn_is_reachable(move->type, square_from, move->square_to);
+}
+
+// Plays a move in SAN, writes it in UCI notation
+static bool pgn_play_san(const char *san, char *uci)
+{
+    struct pgn_san move;
+
+    if (!pgn_parse_san(san, &move))
+        return false;
+
+    for (uint32_t i = 0; i < 64; i++)
+    {
+        mcumax_square square_from = (i & 0x7) + 16 * (i >> 3);
+
+        if (pgn_is_san_origin(&move, square_from) &&
+            pgn_play(square_from, move.square_to, uci))
+            return true;
+    }
+
+    return false;
+}
+
+bool pgn_get_san_move(const char *san,
+                      const mcumax_move *valid_moves,
+                      uint32_t valid_moves_num,
+                      mcumax_move *move)
+{
+    struct pgn_san san_move;
+
+    if (!pgn_parse_san(san, &san_move))
+        return false;
+
+    for (uint32_t i = 0; i < valid_moves_num; i++)
+    {
+        if ((valid_moves[i].to == san_move.square_to) &&
+            pgn_is_san_origin(&san_move, valid_moves[i].from))
+        {
+            *move = valid_moves[i];
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void pgn_replay(FILE *file,
+                uint64_t offset_start,
+                uint64_t offset_end,
+                pgn_record_callback callback,
+                void *userdata,
+                pgn_stats *stats)
+{
+    pgn_reader.file = file;
+    pgn_reader.offset = offset_start;
+    pgn_reader.buffer_index =
+        pgn_reader.buffer_size = 0;
+
+    // Range start may be within a line: start at the next line
+    bool skipping = false;
+
+    if (offset_start)
+    {
+        if (fseeko(file, (off_t)(offset_start - 1), SEEK_SET))
+            return;
+
+        pgn_reader.offset = offset_start - 1;
+
+        char line[2];
+        if (pgn_read_line(line, sizeof(line)) == EOF)
+            return;
+
+        skipping = true;
+    }
+
+    enum pgn_state state = PGN_BETWEEN_GAMES;
+    uint64_t game_offset = 0;
+    bool game_failed = false;
+    char fen_tag[MCUMAX_FEN_SIZE] = "";
+    uint32_t variation_depth = 0;
+
+    char token[PGN_TOKEN_SIZE];
+    size_t token_length = 0;
+
+    char line[PGN_TOKEN_SIZE];
+    char fen[MCUMAX_FEN_SIZE];
+    char uci[8];
+
+    bool line_start = true;
+    bool in_comment = false;
+    bool in_line_comment = false;
+
+    int c;
+    do
+    {
+        c = pgn_getc();
+
+        if (in_comment)
+        {
+            in_comment = (c != '}') && (c != EOF);
+            line_start = (c == '\n');
+
+            continue;
+        }
+
+        if (in_line_comment)
+        {
+            in_line_comment = (c != '\n') && (c != EOF);
+            line_start = (c == '\n');
+
+            continue;
+        }
+
+        // Tag pair
+        if (line_start && (c == '['))
+        {
+            uint64_t line_offset = pgn_reader.offset - 1;
+            int line_end = pgn_read_line(line, sizeof(line));
+            bool event_tag = !strncmp(line, "Event ", 6);
+
+            if (skipping && event_tag)
+                skipping = false;
+
+            if (!skipping)
+            {
+                // New game: previous one ended without result
+                if (state != PGN_TAGS)
+                {
+                    if (state == PGN_MOVES)
+                        stats->games++;
+
+                    if (event_tag && (line_offset >= offset_end))
+                        return;
+
+                    state = PGN_TAGS;
+                    game_offset = line_offset;
+                    fen_tag[0] = '\0';
+                }
+
+                char *value_start = strchr(line, '"');
+                char *value_end = strrchr(line, '"');
+
+                if (!strncmp(line, "FEN ", 4) &&
+                    value_start &&
+                    (value_end > value_start))
+                {
+                    size_t value_length = value_end - value_start - 1;
+
+                    if (value_length >= sizeof(fen_tag))
+                        value_length = sizeof(fen_tag) - 1;
+
+                    memcpy(fen_tag, value_start + 1, value_length);
+                    fen_tag[value_length] = '\0';
+                }
+            }
+
+            line_start = true;
+            c = (line_end == EOF) ? EOF : '\n';
+
+            continue;
+        }
+
+        if (skipping)
+        {
+            line_start = (c == '\n');
+
+            continue;
+        }
+
+        // Escape line
+        if (line_start && (c == '%'))
+        {
+            in_line_comment = true;
+
+            continue;
+        }
+
+        line_start = (c == '\n');
+
+        if ((c != EOF) &&
+            !strchr(" \t\r\n.{};()", c))
+        {
+            if (token_length < (PGN_TOKEN_SIZE - 1))
+                token[token_length++] = c;
+
+            continue;
+        }
+
+        // Token complete
+        if (token_length && !variation_depth)
+        {
+            token[token_length] = '\0';
+
+            bool move_number = (strspn(token, "0123456789") == token_length);
+
+            if (!strcmp(token, "1-0") ||
+                !strcmp(token, "0-1") ||
+                !strcmp(token, "1/2-1/2") ||
+                !strcmp(token, "*"))
+            {
+                // Game termination
+                if (state != PGN_BETWEEN_GAMES)
+                    stats->games++;
+
+                state = PGN_BETWEEN_GAMES;
+            }
+            else if (!move_number &&
+                     (token[0] != '$'))
+            {
+                // Move: first one sets up the position
+                if (state != PGN_MOVES)
+                {
+                    if (state == PGN_BETWEEN_GAMES)
+                    {
+                        game_offset = pgn_reader.offset - token_length - 1;
+                        fen_tag[0] = '\0';
+                    }
+
+                    if (fen_tag[0])
+                        mcumax_set_fen_position(fen_tag);
+                    else
+                        mcumax_init();
+
+                    state = PGN_MOVES;
+                    game_failed = false;
+                }
+
+                if (!game_failed)
+                {
+                    if (callback)
+                        mcumax_get_fen_position(fen, sizeof(fen));
+
+                    if (pgn_play_san(token, uci))
+                    {
+                        stats->positions++;
+
+                        if (callback)
+                            callback(fen, pgn_get_key(fen), uci, userdata);
+                    }
+                    else
+                    {
+                        fprintf(stderr, "pgn: game at offset %llu: unplayable move %s\n",
+                                (unsigned long long)game_offset,
+                                token);
+
+                        stats->errors++;
+                        game_failed = true;
+                    }
+                }
+            }
+        }
+
+        token_length = 0;
+
+        switch (c)
+        {
+        case '{':
+            in_comment = true;
+
+            break;
+
+        case ';':
+            in_line_comment = true;
+
+            break;
+
+        case '(':
+            variation_depth++;
+
+            break;
+
+        case ')':
+            if (variation_depth)
+                variation_depth--;
+
+            break;
+        }
+    } while (c != EOF);
+
+    // Last game ended without result
+    if (state == PGN_MOVES)
+        stats->games++;
+}
+
+#if defined(PGN_STANDALONE)
+
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint64_t pgn_get_time_ns(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+static void pgn_write_record(const char *fen,
+                             uint64_t key,
+                             const char *move,
+                             void *userdata)
+{
+    fprintf((FILE *)userdata, "%s\t%016llx\t%s\n", fen, (unsigned long long)key, move);
+}
+
+// Replays a byte range of the input into an output file (NULL: stdout)
+static bool pgn_run_worker(const char *input_path,
+                           uint64_t offset_start,
+                           uint64_t offset_end,
+                           const char *output_path,
+                           bool quiet,
+                           pgn_stats *stats)
+{
+    FILE *input = input_path ? fopen(input_path, "rb") : stdin;
+    if (!input)
+    {
+        perror(input_path);
+
+        return false;
+    }
+
+    FILE *output = NULL;
+    if (!quiet)
+    {
+        output = output_path ? fopen(output_path, "w") : stdout;
+        if (!output)
+        {
+            perror(output_path);
+
+            return false;
+        }
+
+        setvbuf(output, NULL, _IOFBF, 1 << 20);
+    }
+
+    pgn_replay(input,
+               offset_start,
+               offset_end,
+               quiet ? NULL : pgn_write_record,
+               output,
+               stats);
+
+    if (input != stdin)
+        fclose(input);
+    if (output)
+        fflush(output);
+    if (output && (output != stdout))
+        fclose(output);
+
+    return true;
+}
+
+// mcu-max-pgn [-j workers] [-o output] [-q] [file.pgn]
+// Writes "FEN<tab>key<tab>move" records; with workers, each worker replays a
+// part of the file into output.<worker>
+int main(int argc, char *argv[])
+{
+    uint32_t workers_num = 1;
+    const char *output_path = NULL;
+    bool quiet = false;
+
+    int option;
+    while ((option = getopt(argc, argv, "j:o:q")) != -1)
+    {
+        switch (option)
+        {
+        case 'j':
+            workers_num = strtoul(optarg, NULL, 10);
+            if (workers_num < 1)
+                workers_num = 1;
+
+            break;
+
+        case 'o':
+            output_path = optarg;
+
+            break;
+
+        case 'q':
+            quiet = true;
+
+            break;
+
+        default:
+            fprintf(stderr, "usage: %s [-j workers] [-o output] [-q] [file.pgn]\n", argv[0]);
+
+            return 1;
+        }
+    }
+
+    const char *input_path = ((optind < argc) && strcmp(argv[optind], "-"))
+                                 ? argv[optind]
+                                 : NULL;
+
+    // Split file into byte ranges
+    uint64_t input_size = 0;
+
+    if (input_path && (workers_num > 1))
+    {
+        FILE *input = fopen(input_path, "rb");
+        if (!input || fseeko(input, 0, SEEK_END))
+        {
+            perror(input_path);
+
+            return 1;
+        }
+
+        input_size = ftello(input);
+        fclose(input);
+    }
+
+    if (!input_path || (input_size < workers_num))
+        workers_num = 1;
+
+    if ((workers_num > 1) && !output_path && !quiet)
+    {
+        fprintf(stderr, "%s: -j needs -o or -q\n", argv[0]);
+
+        return 1;
+    }
+
+    uint64_t start_time = pgn_get_time_ns();
+    pgn_stats stats = {0};
+    bool ok = true;
+
+    if (workers_num == 1)
+    {
+        mcumax_init();
+
+        ok = pgn_run_worker(input_path, 0, PGN_OFFSET_END, output_path, quiet, &stats);
+    }
+    else
+    {
+        // One process, and so one engine state, per worker
+        int pipes[workers_num][2];
+        pid_t pids[workers_num];
+
+        for (uint32_t i = 0; i < workers_num; i++)
+        {
+            if (pipe(pipes[i]) ||
+                ((pids[i] = fork()) < 0))
+            {
+                perror("fork");
+
+                return 1;
+            }
+
+            if (!pids[i])
+            {
+                char worker_output_path[1024];
+                snprintf(worker_output_path, sizeof(worker_output_path), "%s.%u", output_path, i);
+
+                mcumax_init();
+
+                pgn_stats worker_stats = {0};
+                bool worker_ok = pgn_run_worker(input_path,
+                                                input_size * i / workers_num,
+                                                (i == workers_num - 1)
+                                                    ? PGN_OFFSET_END
+                                                    : input_size * (i + 1) / workers_num,
+                                                output_path ? worker_output_path : NULL,
+                                                quiet,
+                                                &worker_stats);
+
+                close(pipes[i][0]);
+                if (write(pipes[i][1], &worker_stats, sizeof(worker_stats)) != sizeof(worker_stats))
+                    worker_ok = false;
+
+                _exit(worker_ok ? 0 : 1);
+            }
+
+            close(pipes[i][1]);
+        }
+
+        for (uint32_t i = 0; i < workers_num; i++)
+        {
+            pgn_stats worker_stats = {0};
+            int status;
+
+            if (read(pipes[i][0], &worker_stats, sizeof(worker_stats)) != sizeof(worker_stats))
+                ok = false;
+            close(pipes[i][0]);
+
+            if ((waitpid(pids[i], &status, 0) < 0) ||
+                !WIFEXITED(status) ||
+                WEXITSTATUS(status))
+                ok = false;
+
+            stats.games += worker_stats.games;
+            stats.positions += worker_stats.positions;
+            stats.errors += worker_stats.errors;
+        }
+    }
+
+    uint64_t time = pgn_get_time_ns() - start_time;
+
+    fprintf(stderr, "Games           : %llu\n", (unsigned long long)stats.games);
+    fprintf(stderr, "Positions       : %llu\n", (unsigned long long)stats.positions);
+    fprintf(stderr, "Errors          : %llu\n", (unsigned long long)stats.errors);
+    fprintf(stderr, "Time (ms)       : %llu\n", (unsigned long long)(time / 1000000));
+    fprintf(stderr, "Positions/second: %llu\n",
+            (unsigned long long)(time ? stats.positions * 1000000000 / time : 0));
+
+    return ok ? 0 : 1;
+}
+
+#endif
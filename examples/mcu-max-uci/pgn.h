@@ -0,0 +1,78 @@
+/*
+ * mcu-max UCI chess interface example
+ * PGN reader
+ *
+ * (C) 2022-2024 Gissio
+ *
+ * License: MIT
+ */
+
+#if !defined(PGN_H)
+#define PGN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mcu-max.h"
+
+#define PGN_OFFSET_END UINT64_MAX
+
+typedef struct
+{
+    uint64_t games;
+    uint64_t positions;
+    uint64_t errors; // Games stopped at an unreadable or illegal move
+} pgn_stats;
+
+/**
+ * @brief Called for each move replayed, with the position before the move.
+ *
+ * @param fen The position as a FEN string.
+ * @param key A 64-bit key of the position (FEN board, side, castling, e.p.).
+ * @param move The move in UCI notation.
+ * @param userdata The user data.
+ */
+typedef void (*pgn_record_callback)(const char *fen,
+                                    uint64_t key,
+                                    const char *move,
+                                    void *userdata);
+
+/**
+ * @brief Replays the games of a PGN stream that start within a byte range,
+ * with bounded memory. Uses the engine state.
+ *
+ * Games start at an "[Event " tag line when offset_start is not 0, so a file
+ * can be split into ranges replayed independently.
+ *
+ * @param file The PGN stream (seekable when offset_start is not 0).
+ * @param offset_start The range start.
+ * @param offset_end The range end (PGN_OFFSET_END for the whole stream).
+ * @param callback The record callback (NULL for none).
+ * @param userdata The user data.
+ * @param stats The statistics, incremented.
+ */
+void pgn_replay(FILE *file,
+                uint64_t offset_start,
+                uint64_t offset_end,
+                pgn_record_callback callback,
+                void *userdata,
+                pgn_stats *stats);
+
+/**
+ * @brief Finds a move in SAN notation (e.g. "Nbd7", "O-O", "e8=Q+") among the
+ * valid moves of the current position.
+ *
+ * @param san The move in SAN notation.
+ * @param valid_moves The valid moves, from mcumax_search_valid_moves().
+ * @param valid_moves_num The number of valid moves.
+ * @param move The move found.
+ *
+ * @return The move was found.
+ */
+bool pgn_get_san_move(const char *san,
+                      const mcumax_move *valid_moves,
+                      uint32_t valid_moves_num,
+                      mcumax_move *move);
+
+#endif
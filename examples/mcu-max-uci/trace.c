@@ -0,0 +1,363 @@
+/*
+ * mcu-max UCI chess interface example
+ * Search trace
+ *
+ * (C) 2022-2024 Gissio
+ *
+ * License: MIT
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+#define TRACE_PLY_NUM 256
+#define TRACE_READ_SIZE 4096
+#define TRACE_ROOT_MOVES_NUM 256
+#define TRACE_TYPES_NUM 8
+
+// Records are written when nodes return, so children come before their
+// parent: children of a node not yet traced, per ply
+struct trace_pending
+{
+    bool active;
+    uint32_t node_count; // Before first child
+    uint64_t records;    // Subtrees
+};
+
+struct trace_stats
+{
+    uint64_t records;
+    uint64_t nodes; // Subtrees
+    uint64_t fail_high;
+    uint64_t fail_low;
+};
+
+struct trace_root_move
+{
+    mcumax_move move;
+    uint64_t nodes;
+    uint32_t searches;
+    int16_t score; // Deepest search
+    uint8_t depth;
+};
+
+static const char *trace_type_names[TRACE_TYPES_NUM] = {
+    "Full-width",
+    "Null move",
+    "Verification",
+    "Reduced",
+    "Re-search",
+    "Hash cut",
+    "Quiescence",
+    "Draw",
+};
+
+static struct
+{
+    struct trace_pending pending[TRACE_PLY_NUM + 1];
+    struct trace_stats plies[TRACE_PLY_NUM];
+    struct trace_stats types[TRACE_TYPES_NUM];
+    struct trace_root_move root_moves[TRACE_ROOT_MOVES_NUM];
+    uint32_t root_moves_num;
+    uint32_t node_count; // Of last record
+    uint64_t orphans;    // Parent not in trace
+} trace;
+
+#ifdef MCUMAX_TRACE
+bool trace_save(const char *path,
+                const mcumax_trace_record *buffer,
+                uint32_t buffer_size)
+{
+    uint32_t count = mcumax_get_trace_count();
+
+    struct trace_file_header header = {
+        TRACE_FILE_MAGIC,
+        TRACE_FILE_VERSION,
+        sizeof(mcumax_trace_record),
+        (count < buffer_size) ? count : buffer_size,
+        (count < buffer_size) ? 0 : count - buffer_size,
+    };
+
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return false;
+
+    // Oldest first
+    uint32_t start = header.records_dropped ? count % buffer_size : 0;
+    uint32_t tail = (header.records_num < buffer_size - start)
+                        ? header.records_num
+                        : buffer_size - start;
+
+    bool ok = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+              (fwrite(buffer + start, sizeof(mcumax_trace_record), tail, file) == tail) &&
+              (fwrite(buffer, sizeof(mcumax_trace_record), header.records_num - tail, file) ==
+               header.records_num - tail);
+
+    return !fclose(file) && ok;
+}
+#endif
+
+static void trace_print_move(mcumax_move move)
+{
+    if (move.from == MCUMAX_SQUARE_INVALID)
+        printf("null");
+    else
+        printf("%c%c%c%c",
+               'a' + (move.from & 0x7),
+               '8' - (move.from >> 4),
+               'a' + (move.to & 0x7),
+               '8' - (move.to >> 4));
+}
+
+static void trace_add_stats(struct trace_stats *stats,
+                            const mcumax_trace_record *record,
+                            uint32_t nodes)
+{
+    stats->records++;
+    stats->nodes += nodes;
+    stats->fail_high += (record->score >= record->beta);
+    stats->fail_low += (record->score <= record->alpha);
+}
+
+static void trace_add_root_move(const mcumax_trace_record *record, uint32_t nodes)
+{
+    struct trace_root_move *root_move = trace.root_moves;
+    struct trace_root_move *root_moves_end = trace.root_moves + trace.root_moves_num;
+
+    while ((root_move < root_moves_end) &&
+           ((root_move->move.from != record->move.from) ||
+            (root_move->move.to != record->move.to)))
+        root_move++;
+
+    if (root_move == root_moves_end)
+    {
+        if (trace.root_moves_num == TRACE_ROOT_MOVES_NUM)
+            return;
+
+        trace.root_moves_num++;
+        root_move->move = record->move;
+    }
+
+    root_move->nodes += nodes;
+    root_move->searches++;
+
+    // Deepest search
+    if (record->depth >= root_move->depth)
+    {
+        root_move->score = record->score;
+        root_move->depth = record->depth;
+    }
+}
+
+static void trace_add_record(const mcumax_trace_record *record)
+{
+    uint32_t ply = record->ply;
+
+    // Subtree: children pending at next ply
+    struct trace_pending *children = &trace.pending[ply + 1];
+    uint32_t node_count = children->active ? children->node_count : trace.node_count;
+    uint64_t records = 1 + children->records;
+    uint32_t nodes = record->node_count - node_count;
+
+    *children = (struct trace_pending){0};
+
+    // Deeper pending records lost their parent to the ring
+    for (uint32_t i = ply + 2; i <= TRACE_PLY_NUM; i++)
+    {
+        trace.orphans += trace.pending[i].records;
+        trace.pending[i] = (struct trace_pending){0};
+    }
+
+    struct trace_pending *siblings = &trace.pending[ply];
+    if (!siblings->active)
+    {
+        siblings->active = true;
+        siblings->node_count = node_count;
+    }
+    siblings->records += records;
+
+    trace.node_count = record->node_count;
+
+    // Statistics
+    trace_add_stats(&trace.plies[ply], record, nodes);
+
+    uint8_t flags = record->flags;
+
+    if (!(flags & (MCUMAX_TRACE_NULL_MOVE |
+                   MCUMAX_TRACE_VERIFY |
+                   MCUMAX_TRACE_HASH_CUT |
+                   MCUMAX_TRACE_QUIESCENCE |
+                   MCUMAX_TRACE_DRAW)))
+        trace_add_stats(&trace.types[0], record, nodes);
+
+    for (uint32_t i = 1; i < TRACE_TYPES_NUM; i++)
+    {
+        if (flags & (1 << (i - 1)))
+            trace_add_stats(&trace.types[i], record, nodes);
+    }
+
+    if (!ply)
+    {
+        printf("Iteration depth %2u score %6d nodes %10u records %10llu best ",
+               record->depth,
+               record->score,
+               nodes,
+               (unsigned long long)records);
+        trace_print_move(record->move);
+        printf("\n");
+
+        trace.pending[0] = (struct trace_pending){0};
+    }
+    else if ((ply == 1) &&
+             !(flags & (MCUMAX_TRACE_NULL_MOVE | MCUMAX_TRACE_VERIFY)))
+        trace_add_root_move(record, nodes);
+}
+
+static int trace_compare_root_moves(const void *a, const void *b)
+{
+    const struct trace_root_move *root_move_a = a;
+    const struct trace_root_move *root_move_b = b;
+
+    return (root_move_a->nodes < root_move_b->nodes) - (root_move_a->nodes > root_move_b->nodes);
+}
+
+static uint32_t trace_percent(uint64_t value, uint64_t total)
+{
+    return total ? (uint32_t)(100 * value / total) : 0;
+}
+
+bool trace_summarize(FILE *file, uint32_t root_moves_max)
+{
+    struct trace_file_header header;
+
+    if ((fread(&header, sizeof(header), 1, file) != 1) ||
+        strncmp(header.magic, TRACE_FILE_MAGIC, sizeof(header.magic)) ||
+        (header.version != TRACE_FILE_VERSION) ||
+        (header.record_size != sizeof(mcumax_trace_record)))
+        return false;
+
+    memset(&trace, 0, sizeof(trace));
+
+    mcumax_trace_record records[TRACE_READ_SIZE];
+    uint64_t records_num = 0;
+    size_t read_num;
+
+    while ((read_num = fread(records, sizeof(mcumax_trace_record), TRACE_READ_SIZE, file)))
+    {
+        if (!records_num)
+            trace.node_count = records[0].node_count;
+
+        for (size_t i = 0; i < read_num; i++)
+            trace_add_record(&records[i]);
+
+        records_num += read_num;
+    }
+
+    // Not returned when the trace ended, or parent lost to the ring
+    uint64_t unfinished = 0;
+    for (uint32_t i = 1; i <= TRACE_PLY_NUM; i++)
+        unfinished += trace.pending[i].records;
+
+    printf("\n");
+    printf("Records         : %llu\n", (unsigned long long)records_num);
+    printf("Records dropped : %u\n", header.records_dropped);
+    printf("Orphans         : %llu\n", (unsigned long long)(trace.orphans + unfinished));
+
+    printf("\n");
+    printf("Type            Records      Nodes  High%%   Low%%\n");
+    for (uint32_t i = 0; i < TRACE_TYPES_NUM; i++)
+    {
+        struct trace_stats *stats = &trace.types[i];
+
+        printf("%-12s %10llu %10llu %6u %6u\n",
+               trace_type_names[i],
+               (unsigned long long)stats->records,
+               (unsigned long long)stats->nodes,
+               trace_percent(stats->fail_high, stats->records),
+               trace_percent(stats->fail_low, stats->records));
+    }
+
+    printf("\n");
+    printf("Ply             Records      Nodes  High%%   Low%%   Nodes/record\n");
+    for (uint32_t i = 0; i < TRACE_PLY_NUM; i++)
+    {
+        struct trace_stats *stats = &trace.plies[i];
+
+        if (!stats->records)
+            continue;
+
+        printf("%-12u %10llu %10llu %6u %6u %14llu\n",
+               i,
+               (unsigned long long)stats->records,
+               (unsigned long long)stats->nodes,
+               trace_percent(stats->fail_high, stats->records),
+               trace_percent(stats->fail_low, stats->records),
+               (unsigned long long)(stats->nodes / stats->records));
+    }
+
+    qsort(trace.root_moves,
+          trace.root_moves_num,
+          sizeof(struct trace_root_move),
+          trace_compare_root_moves);
+
+    uint64_t root_nodes = 0;
+    for (uint32_t i = 0; i < trace.root_moves_num; i++)
+        root_nodes += trace.root_moves[i].nodes;
+
+    printf("\n");
+    printf("Root move     Searches      Nodes Nodes%%  Score  Depth\n");
+    for (uint32_t i = 0; (i < trace.root_moves_num) && (i < root_moves_max); i++)
+    {
+        struct trace_root_move *root_move = &trace.root_moves[i];
+
+        trace_print_move(root_move->move);
+        printf("         %10u %10llu %6u %6d %6u\n",
+               root_move->searches,
+               (unsigned long long)root_move->nodes,
+               trace_percent(root_move->nodes, root_nodes),
+               -root_move->score,
+               root_move->depth);
+    }
+
+    return true;
+}
+
+#if defined(TRACE_STANDALONE)
+
+// mcu-max-trace [root moves] <file>
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s [root moves] <file>\n", argv[0]);
+
+        return 1;
+    }
+
+    const char *path = argv[argc - 1];
+    FILE *file = fopen(path, "rb");
+
+    if (!file)
+    {
+        perror(path);
+
+        return 1;
+    }
+
+    bool ok = trace_summarize(file,
+                              (argc > 2) ? strtoul(argv[1], NULL, 10) : 10);
+    fclose(file);
+
+    if (!ok)
+    {
+        fprintf(stderr, "%s: not a trace file\n", path);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+#endif
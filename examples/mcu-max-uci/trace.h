@@ -0,0 +1,59 @@
+/*
+ * mcu-max UCI chess interface example
+ * Search trace
+ *
+ * (C) 2022-2024 Gissio
+ *
+ * License: MIT
+ */
+
+#if !defined(TRACE_H)
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mcu-max.h"
+
+#define TRACE_FILE_MAGIC "mcu-max trace"
+#define TRACE_FILE_VERSION 1
+
+// Trace file: header, then records oldest first
+struct trace_file_header
+{
+    char magic[16];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t records_num;
+    uint32_t records_dropped; // Overwritten in the ring
+};
+
+#ifdef MCUMAX_TRACE
+/**
+ * @brief Saves the records of the engine trace buffer to a file.
+ *
+ * @param path The file path.
+ * @param buffer The trace buffer set with mcumax_set_trace_buffer().
+ * @param buffer_size The buffer size, in records.
+ *
+ * @return The trace was saved.
+ */
+bool trace_save(const char *path,
+                const mcumax_trace_record *buffer,
+                uint32_t buffer_size);
+#endif
+
+/**
+ * @brief Rebuilds the search tree of a trace file and prints a summary:
+ * records by node type, cutoffs and subtree sizes by ply, and the nodes
+ * spent per iteration and per root move.
+ *
+ * @param file The trace file.
+ * @param root_moves_max The maximum number of root moves to print.
+ *
+ * @return The file was a valid trace.
+ */
+bool trace_summarize(FILE *file, uint32_t root_moves_max);
+
+#endif
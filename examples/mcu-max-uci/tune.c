@@ -0,0 +1,546 @@
+/*
+ * mcu-max UCI chess interface example
+ * Evaluation tuning
+ *
+ * (C) 2022-2024 Gissio
+ *
+ * License: MIT
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tune.h"
+
+#define TUNE_LINE_SIZE 1024
+#define TUNE_THREADS_MAX 64
+#define TUNE_PARAMS_MAX 1024
+
+// Phase weights and castling bonus are not tuned
+#include "mcu-max-eval.h"
+
+struct tune_param
+{
+    int16_t *value;
+    int16_t min;
+    int16_t max;
+};
+
+struct tune_worker
+{
+    const tune_dataset *dataset;
+    const mcumax_eval_params *params;
+    const tune_config *config;
+    uint32_t first;
+    uint32_t last;
+    double error;
+};
+
+uint32_t tune_load(FILE *file, tune_dataset *dataset)
+{
+    uint32_t positions_num = dataset->positions_num;
+    uint32_t positions_size = positions_num;
+    char line[TUNE_LINE_SIZE];
+
+    while (fgets(line, sizeof(line), file))
+    {
+        // Position: board, side, castling, e.p. fields
+        char fen[MCUMAX_FEN_SIZE] = "";
+        char *p = line;
+        bool valid = true;
+
+        for (uint32_t i = 0; valid && (i < 4); i++)
+        {
+            p += strspn(p, " \t");
+            size_t length = strcspn(p, " \t\r\n");
+
+            if (!length ||
+                ((strlen(fen) + length + 2) >= sizeof(fen)))
+                valid = false;
+            else
+            {
+                strncat(fen, p, length);
+                strcat(fen, " ");
+                p += length;
+            }
+        }
+
+        // Result, white's view
+        char *bracket = strchr(p, '[');
+        int32_t result = -1;
+
+        if (strstr(p, "1/2-1/2"))
+            result = 1;
+        else if (strstr(p, "1-0"))
+            result = 2;
+        else if (strstr(p, "0-1"))
+            result = 0;
+        else if (bracket)
+        {
+            double value = strtod(bracket + 1, NULL);
+
+            if ((value >= 0) && (value <= 1))
+                result = (int32_t)(value * 2 + 0.5);
+        }
+
+        if (!valid || (result < 0))
+            continue;
+
+        if (positions_num == positions_size)
+        {
+            positions_size = positions_size ? 2 * positions_size : 0x10000;
+            dataset->positions = realloc(dataset->positions,
+                                         positions_size * sizeof(mcumax_eval_position));
+            dataset->results = realloc(dataset->results, positions_size);
+        }
+
+        mcumax_set_fen_position(fen);
+        mcumax_get_eval_position(&dataset->positions[positions_num]);
+        dataset->results[positions_num] = result;
+        positions_num++;
+    }
+
+    uint32_t read_num = positions_num - dataset->positions_num;
+    dataset->positions_num = positions_num;
+
+    return read_num;
+}
+
+static void *tune_run_worker(void *arg)
+{
+    struct tune_worker *worker = arg;
+    const tune_dataset *dataset = worker->dataset;
+
+    double error = 0;
+
+    for (uint32_t i = worker->first; i < worker->last; i++)
+    {
+        const mcumax_eval_position *position = &dataset->positions[i];
+
+        int32_t score = worker->config->quiescence_depth
+                            ? mcumax_evaluate_quiescence(position,
+                                                         worker->params,
+                                                         worker->config->quiescence_depth)
+                            : mcumax_evaluate(position, worker->params);
+
+        // White's view
+        if (position->side == 0x10)
+            score = -score;
+
+        double expected = 1.0 / (1.0 + pow(10.0, -worker->config->k * score / 400.0));
+        double difference = dataset->results[i] / 2.0 - expected;
+
+        error += difference * difference;
+    }
+
+    worker->error = error;
+
+    return NULL;
+}
+
+double tune_get_error(const tune_dataset *dataset,
+                      const mcumax_eval_params *params,
+                      const tune_config *config)
+{
+    uint32_t threads_num = config->threads_num;
+    if (threads_num < 1)
+        threads_num = 1;
+    else if (threads_num > TUNE_THREADS_MAX)
+        threads_num = TUNE_THREADS_MAX;
+
+    pthread_t threads[TUNE_THREADS_MAX];
+    struct tune_worker workers[TUNE_THREADS_MAX];
+
+    for (uint32_t i = 0; i < threads_num; i++)
+    {
+        workers[i] = (struct tune_worker){
+            dataset,
+            params,
+            config,
+            (uint32_t)((uint64_t)dataset->positions_num * i / threads_num),
+            (uint32_t)((uint64_t)dataset->positions_num * (i + 1) / threads_num),
+            0,
+        };
+
+        // Last worker runs on this thread
+        if ((i == (threads_num - 1)) ||
+            pthread_create(&threads[i], NULL, tune_run_worker, &workers[i]))
+        {
+            workers[i].last = dataset->positions_num;
+            tune_run_worker(&workers[i]);
+            threads_num = i + 1;
+
+            break;
+        }
+    }
+
+    double error = workers[threads_num - 1].error;
+
+    for (uint32_t i = 0; i < (threads_num - 1); i++)
+    {
+        pthread_join(threads[i], NULL);
+        error += workers[i].error;
+    }
+
+    return dataset->positions_num ? error / dataset->positions_num : 0;
+}
+
+void tune_fit_k(const tune_dataset *dataset,
+                const mcumax_eval_params *params,
+                tune_config *config)
+{
+    double error = tune_get_error(dataset, params, config);
+
+    for (double step = 0.1; step >= 0.0001; step /= 10)
+    {
+        for (int32_t direction = -1; direction <= 1; direction += 2)
+        {
+            for (;;)
+            {
+                double k = config->k;
+
+                config->k = k + direction * step;
+                if (config->k <= 0)
+                {
+                    config->k = k;
+
+                    break;
+                }
+
+                double new_error = tune_get_error(dataset, params, config);
+
+                if (new_error >= error)
+                {
+                    config->k = k;
+
+                    break;
+                }
+
+                error = new_error;
+            }
+        }
+    }
+}
+
+static void tune_add_param(struct tune_param *params,
+                           uint32_t *params_num,
+                           int16_t *value,
+                           int16_t min,
+                           int16_t max)
+{
+    if (*params_num < TUNE_PARAMS_MAX)
+        params[(*params_num)++] = (struct tune_param){value, min, max};
+}
+
+// Material of a full army, kept under the score limit
+static int32_t tune_get_material(const mcumax_eval_params *params)
+{
+    const int16_t *values = params->piece_values;
+
+    return 8 * values[MCUMAX_PAWN_UPSTREAM] +
+           2 * (values[MCUMAX_KNIGHT] + values[MCUMAX_BISHOP] + values[MCUMAX_ROOK]) +
+           values[MCUMAX_QUEEN];
+}
+
+// Tuned parameters, in the range of their tables; pawn value is the scale
+static uint32_t tune_get_params(mcumax_eval_params *params, struct tune_param *tune_params)
+{
+    uint32_t params_num = 0;
+
+    for (uint32_t type = MCUMAX_KNIGHT; type <= MCUMAX_QUEEN; type++)
+    {
+        if (type != MCUMAX_KING)
+            tune_add_param(tune_params, &params_num, &params->piece_values[type], 1, INT16_MAX);
+    }
+
+    for (uint32_t piece = 0; piece < 6; piece++)
+    {
+        for (uint32_t index = 0; index < 64; index++)
+        {
+            // No pawns on first and last rank
+            if (!piece && ((index < 8) || (index >= 56)))
+                continue;
+
+            tune_add_param(tune_params, &params_num, &params->pst_mg[piece][index], INT8_MIN, INT8_MAX);
+            tune_add_param(tune_params, &params_num, &params->pst_eg[piece][index], INT8_MIN, INT8_MAX);
+        }
+    }
+
+    tune_add_param(tune_params, &params_num, &params->pawn_doubled_mg, INT8_MIN, INT8_MAX);
+    tune_add_param(tune_params, &params_num, &params->pawn_doubled_eg, INT8_MIN, INT8_MAX);
+    tune_add_param(tune_params, &params_num, &params->pawn_isolated_mg, INT8_MIN, INT8_MAX);
+    tune_add_param(tune_params, &params_num, &params->pawn_isolated_eg, INT8_MIN, INT8_MAX);
+
+    for (uint32_t row = 1; row < 7; row++)
+    {
+        tune_add_param(tune_params, &params_num, &params->pawn_passed_mg[row], INT8_MIN, INT8_MAX);
+        tune_add_param(tune_params, &params_num, &params->pawn_passed_eg[row], INT8_MIN, INT8_MAX);
+    }
+
+    for (uint32_t shelter = 0; shelter < 3; shelter++)
+        tune_add_param(tune_params, &params_num, &params->king_shelter_mg[shelter], INT8_MIN, INT8_MAX);
+
+    return params_num;
+}
+
+uint32_t tune_run_pass(const tune_dataset *dataset,
+                       mcumax_eval_params *params,
+                       const tune_config *config)
+{
+    struct tune_param tune_params[TUNE_PARAMS_MAX];
+    uint32_t params_num = tune_get_params(params, tune_params);
+    uint32_t changed_num = 0;
+
+    double error = tune_get_error(dataset, params, config);
+
+    for (uint32_t i = 0; i < params_num; i++)
+    {
+        struct tune_param *tune_param = &tune_params[i];
+        int16_t value = *tune_param->value;
+        bool improved = false;
+
+        for (int32_t direction = 1; !improved && (direction >= -1); direction -= 2)
+        {
+            if (((direction > 0) && (value >= tune_param->max)) ||
+                ((direction < 0) && (value <= tune_param->min)))
+                continue;
+
+            *tune_param->value = value + direction;
+
+            if (tune_get_material(params) >= MCUMAX_SCORE_MAX)
+                continue;
+
+            double new_error = tune_get_error(dataset, params, config);
+
+            if (new_error < error)
+            {
+                error = new_error;
+                improved = true;
+            }
+        }
+
+        if (improved)
+            changed_num++;
+        else
+            *tune_param->value = value;
+    }
+
+    return changed_num;
+}
+
+static void tune_write_array(FILE *file, const int16_t *values, uint32_t values_num, uint32_t row_size)
+{
+    for (uint32_t i = 0; i < values_num; i++)
+    {
+        if (!(i % row_size))
+            fprintf(file, "        ");
+
+        fprintf(file, "%4d,", values[i]);
+
+        fprintf(file, ((i % row_size) == (row_size - 1)) ? "\n" : "");
+    }
+}
+
+static void tune_write_pst(FILE *file, const char *name, const int16_t values[6][64])
+{
+    static const char *piece_names[] = {
+        "Pawn", "Knight", "King", "Bishop", "Rook", "Queen"};
+
+    fprintf(file, "static const int8_t %s[6][64] = {\n", name);
+
+    for (uint32_t piece = 0; piece < 6; piece++)
+    {
+        fprintf(file, "    // %s\n", piece_names[piece]);
+        fprintf(file, "    {\n");
+        tune_write_array(file, values[piece], 64, 8);
+        fprintf(file, "    },\n");
+    }
+
+    fprintf(file, "};\n\n");
+}
+
+static void tune_write_row(FILE *file, const char *type, const char *name, const int16_t *values, uint32_t values_num)
+{
+    fprintf(file, "static const %s %s[%u] = {\n    ", type, name, values_num);
+
+    for (uint32_t i = 0; i < values_num; i++)
+        fprintf(file, "%d%s", values[i], (i < (values_num - 1)) ? ", " : "};\n");
+}
+
+void tune_write_tables(FILE *file, const mcumax_eval_params *params)
+{
+    fprintf(file,
+            "/*\n"
+            " * mcu-max\n"
+            " * Chess game engine for low-resource MCUs\n"
+            " *\n"
+            " * Evaluation tables, tuned by mcu-max-tune. Use with\n"
+            " * MCUMAX_EVAL_TABLES=\"<this file>\".\n"
+            " */\n"
+            "\n"
+            "#if !defined(MCU_MAX_EVAL_H)\n"
+            "#define MCU_MAX_EVAL_H\n"
+            "\n"
+            "#include <stdint.h>\n"
+            "\n");
+
+    fprintf(file, "// Material by piece type; king negative, marks king captures\n");
+    tune_write_row(file, "int16_t", "mcumax_piece_values", params->piece_values, 8);
+
+    int16_t phase_weights[8];
+    for (uint32_t i = 0; i < 8; i++)
+        phase_weights[i] = mcumax_phase_weights[i];
+
+    fprintf(file, "\n// Game phase: weight of each piece type, full board = MCUMAX_PHASE_MAX\n");
+    fprintf(file, "#define MCUMAX_PHASE_MAX %d\n\n", MCUMAX_PHASE_MAX);
+    tune_write_row(file, "uint8_t", "mcumax_phase_weights", phase_weights, 8);
+
+    fprintf(file,
+            "\n"
+            "// Piece-square tables, white's view, rank 8 first\n"
+            "// Order: pawn, knight, king, bishop, rook, queen\n"
+            "#define MCUMAX_PST_PIECE(type) ((type) - 1 - ((type) > 1))\n"
+            "#define MCUMAX_PST_SQUARE(index) (index)\n"
+            "\n");
+    tune_write_pst(file, "mcumax_pst_mg", params->pst_mg);
+    tune_write_pst(file, "mcumax_pst_eg", params->pst_eg);
+
+    fprintf(file,
+            "// Pawn structure, white's view: penalties per pawn, passed pawn bonus by row\n"
+            "// (rank 8 first), king shelter by shield pawn (none, one rank, two ranks ahead)\n");
+    fprintf(file, "#define MCUMAX_PAWN_DOUBLED_MG %d\n", params->pawn_doubled_mg);
+    fprintf(file, "#define MCUMAX_PAWN_DOUBLED_EG %d\n", params->pawn_doubled_eg);
+    fprintf(file, "#define MCUMAX_PAWN_ISOLATED_MG %d\n", params->pawn_isolated_mg);
+    fprintf(file, "#define MCUMAX_PAWN_ISOLATED_EG %d\n\n", params->pawn_isolated_eg);
+    tune_write_row(file, "int8_t", "mcumax_pawn_passed_mg", params->pawn_passed_mg, 8);
+    tune_write_row(file, "int8_t", "mcumax_pawn_passed_eg", params->pawn_passed_eg, 8);
+    tune_write_row(file, "int8_t", "mcumax_king_shelter_mg", params->king_shelter_mg, 3);
+
+    fprintf(file,
+            "\n"
+            "// Search bonus for castling moves\n"
+            "#define MCUMAX_CASTLING_BONUS %d\n"
+            "\n"
+            "#endif\n",
+            MCUMAX_CASTLING_BONUS);
+}
+
+#if defined(TUNE_STANDALONE)
+
+#include <unistd.h>
+
+// mcu-max-tune [-j threads] [-q depth] [-i passes] [-o tables.h] file...
+int main(int argc, char *argv[])
+{
+    tune_config config = {1.0, 0, 1};
+    uint32_t passes_max = 100;
+    const char *output_path = NULL;
+
+    int option;
+    while ((option = getopt(argc, argv, "j:q:i:o:")) != -1)
+    {
+        switch (option)
+        {
+        case 'j':
+            config.threads_num = strtoul(optarg, NULL, 10);
+
+            break;
+
+        case 'q':
+            config.quiescence_depth = strtoul(optarg, NULL, 10);
+
+            break;
+
+        case 'i':
+            passes_max = strtoul(optarg, NULL, 10);
+
+            break;
+
+        case 'o':
+            output_path = optarg;
+
+            break;
+
+        default:
+            optind = argc + 1;
+
+            break;
+        }
+    }
+
+    if (optind >= argc)
+    {
+        fprintf(stderr, "usage: %s [-j threads] [-q depth] [-i passes] [-o tables.h] file...\n", argv[0]);
+
+        return 1;
+    }
+
+    // Read datasets
+    tune_dataset dataset = {NULL, NULL, 0};
+
+    mcumax_init();
+
+    for (int i = optind; i < argc; i++)
+    {
+        FILE *file = fopen(argv[i], "r");
+        if (!file)
+        {
+            perror(argv[i]);
+
+            return 1;
+        }
+
+        uint32_t read_num = tune_load(file, &dataset);
+        fclose(file);
+
+        fprintf(stderr, "%s: %u positions\n", argv[i], read_num);
+    }
+
+    if (!dataset.positions_num)
+    {
+        fprintf(stderr, "%s: no labelled positions\n", argv[0]);
+
+        return 1;
+    }
+
+    // Tune, starting from the compiled tables
+    mcumax_eval_params params;
+    mcumax_get_eval_params(&params);
+
+    tune_fit_k(&dataset, &params, &config);
+
+    fprintf(stderr, "K %.4f, error %.6f\n", config.k, tune_get_error(&dataset, &params, &config));
+
+    for (uint32_t i = 0; i < passes_max; i++)
+    {
+        uint32_t changed_num = tune_run_pass(&dataset, &params, &config);
+
+        fprintf(stderr, "Pass %u: error %.6f, %u parameters changed\n",
+                i + 1,
+                tune_get_error(&dataset, &params, &config),
+                changed_num);
+
+        if (!changed_num)
+            break;
+    }
+
+    // Tables
+    FILE *output = output_path ? fopen(output_path, "w") : stdout;
+    if (!output)
+    {
+        perror(output_path);
+
+        return 1;
+    }
+
+    tune_write_tables(output, &params);
+
+    if (output_path)
+        fclose(output);
+
+    return 0;
+}
+
+#endif
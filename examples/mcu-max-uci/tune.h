@@ -0,0 +1,93 @@
+/*
+ * mcu-max UCI chess interface example
+ * Evaluation tuning
+ *
+ * (C) 2022-2024 Gissio
+ *
+ * License: MIT
+ */
+
+#if !defined(TUNE_H)
+#define TUNE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mcu-max.h"
+
+typedef struct
+{
+    mcumax_eval_position *positions;
+    uint8_t *results; // White's result in half points: 0, 1, 2
+    uint32_t positions_num;
+} tune_dataset;
+
+typedef struct
+{
+    double k;                  // Sigmoid scale
+    uint32_t quiescence_depth; // 0 for static evaluation
+    uint32_t threads_num;
+} tune_config;
+
+/**
+ * @brief Reads labelled positions, one per line: a FEN position followed by
+ * the game result, as "1-0", "0-1", "1/2-1/2" or "[1.0]", "[0.5]", "[0.0]".
+ * Lines without a result are skipped.
+ *
+ * @param file The input file.
+ * @param dataset The dataset, positions appended.
+ *
+ * @return The number of positions read.
+ */
+uint32_t tune_load(FILE *file, tune_dataset *dataset);
+
+/**
+ * @brief Returns the mean squared error between the game results and the
+ * evaluations mapped to expected results by the sigmoid
+ * 1 / (1 + 10^(-k * score / 400)).
+ *
+ * @param dataset The dataset.
+ * @param params The evaluation parameters.
+ * @param config The tuning configuration.
+ */
+double tune_get_error(const tune_dataset *dataset,
+                      const mcumax_eval_params *params,
+                      const tune_config *config);
+
+/**
+ * @brief Sets the sigmoid scale that minimizes the error of the given
+ * parameters.
+ *
+ * @param dataset The dataset.
+ * @param params The evaluation parameters.
+ * @param config The tuning configuration, k set.
+ */
+void tune_fit_k(const tune_dataset *dataset,
+                const mcumax_eval_params *params,
+                tune_config *config);
+
+/**
+ * @brief Runs one pass of local search: each parameter is moved by +1 or -1
+ * while this lowers the error.
+ *
+ * @param dataset The dataset.
+ * @param params The evaluation parameters, updated.
+ * @param config The tuning configuration.
+ *
+ * @return The number of parameters changed.
+ */
+uint32_t tune_run_pass(const tune_dataset *dataset,
+                       mcumax_eval_params *params,
+                       const tune_config *config);
+
+/**
+ * @brief Writes the parameters as an evaluation tables header, for use
+ * with MCUMAX_EVAL_TABLES.
+ *
+ * @param file The output file.
+ * @param params The evaluation parameters.
+ */
+void tune_write_tables(FILE *file, const mcumax_eval_params *params);
+
+#endif
@@ -0,0 +1,338 @@
+/*
+ * mcu-max
+ * Chess game engine for low-resource MCUs
+ *
+ * (C) 2022-2024 Gissio
+ *
+ * License: MIT
+ *
+ * Evaluation tables. Select another profile with MCUMAX_EVAL_COMPACT, or
+ * provide your own tables by defining MCUMAX_EVAL_TABLES as a header name.
+ */
+
+#if !defined(MCU_MAX_EVAL_H)
+#define MCU_MAX_EVAL_H
+
+#include <stdint.h>
+
+// Material by piece type; king negative, marks king captures
+static const int16_t mcumax_piece_values[] = {
+    0, 74, 74, 259, -37, 296, 444, 851};
+
+// Game phase: weight of each piece type, full board = MCUMAX_PHASE_MAX
+#define MCUMAX_PHASE_MAX 32
+
+static const uint8_t mcumax_phase_weights[] = {
+    0, 0, 0, 1, 0, 1, 3, 6};
+
+// Piece-square tables, white's view, rank 8 first
+// Order: pawn, knight, king, bishop, rook, queen
+#define MCUMAX_PST_PIECE(type) ((type) - 1 - ((type) > 1))
+
+#if defined(MCUMAX_EVAL_COMPACT)
+
+// Compact profile: files e-h mirror files d-a
+#define MCUMAX_PST_SQUARE(index) \
+    ((((index) >> 1) & 0x1c) | (((index) ^ (((index) & 0x4) ? 0x7 : 0)) & 0x3))
+
+static const int8_t mcumax_pst_mg[6][32] = {
+    // Pawn
+    {
+          0,   0,   0,   0,
+          8,   8,   8,  10,
+          6,   6,   6,   8,
+          4,   4,   7,  12,
+          2,   2,   5,  10,
+          2,   2,   3,   5,
+          2,   2,   2,   0,
+          0,   0,   0,   0,
+    },
+    // Knight
+    {
+        -20, -15, -10,  -5,
+        -15, -10,  -5,   0,
+        -10,  -5,   0,   5,
+         -5,   0,   5,  10,
+         -5,   0,   5,  10,
+        -10,  -5,   0,   5,
+        -15, -10,  -5,   0,
+        -20, -15, -10,  -5,
+    },
+    // King
+    {
+        -40, -40, -40, -40,
+        -38, -38, -38, -38,
+        -32, -32, -32, -32,
+        -26, -26, -26, -26,
+        -20, -20, -20, -20,
+        -14, -14, -14, -14,
+          0,   2,  -5, -10,
+          5,  11,   3,  -3,
+    },
+    // Bishop
+    {
+         -6,  -4,  -2,   0,
+         -4,  -2,   0,   2,
+         -2,   0,   2,   4,
+          0,   2,   4,   6,
+          0,   2,   4,   6,
+         -2,   0,   2,   4,
+         -4,  -2,   0,   2,
+         -6,  -4,  -2,   0,
+    },
+    // Rook
+    {
+          0,   0,   0,   3,
+         10,  10,  10,  13,
+          0,   0,   0,   3,
+          0,   0,   0,   3,
+          0,   0,   0,   3,
+          0,   0,   0,   3,
+          0,   0,   0,   3,
+          0,   0,   0,   3,
+    },
+    // Queen
+    {
+         -4,  -3,  -2,  -1,
+         -3,  -2,  -1,   0,
+         -2,  -1,   0,   1,
+         -1,   0,   1,   2,
+         -1,   0,   1,   2,
+         -2,  -1,   0,   1,
+         -3,  -2,  -1,   0,
+         -4,  -3,  -2,  -1,
+    },
+};
+
+static const int8_t mcumax_pst_eg[6][32] = {
+    // Pawn
+    {
+          0,   0,   0,   0,
+         46,  46,  46,  46,
+         30,  30,  30,  30,
+         18,  18,  18,  18,
+         10,  10,  10,  10,
+          4,   4,   4,   4,
+          0,   0,   0,   0,
+          0,   0,   0,   0,
+    },
+    // Knight
+    {
+        -12,  -9,  -6,  -3,
+         -9,  -6,  -3,   0,
+         -6,  -3,   0,   3,
+         -3,   0,   3,   6,
+         -3,   0,   3,   6,
+         -6,  -3,   0,   3,
+         -9,  -6,  -3,   0,
+        -12,  -9,  -6,  -3,
+    },
+    // King
+    {
+        -20, -14,  -8,  -2,
+        -14,  -8,  -2,   4,
+         -8,  -2,   4,  10,
+         -2,   4,  10,  16,
+         -2,   4,  10,  16,
+         -8,  -2,   4,  10,
+        -14,  -8,  -2,   4,
+        -20, -14,  -8,  -2,
+    },
+    // Bishop
+    {
+         -8,  -6,  -4,  -2,
+         -6,  -4,  -2,   0,
+         -4,  -2,   0,   2,
+         -2,   0,   2,   4,
+         -2,   0,   2,   4,
+         -4,  -2,   0,   2,
+         -6,  -4,  -2,   0,
+         -8,  -6,  -4,  -2,
+    },
+    // Rook
+    {
+          0,   0,   0,   0,
+          6,   6,   6,   6,
+          0,   0,   0,   0,
+          0,   0,   0,   0,
+          0,   0,   0,   0,
+          0,   0,   0,   0,
+          0,   0,   0,   0,
+          0,   0,   0,   0,
+    },
+    // Queen
+    {
+        -10,  -7,  -4,  -1,
+         -7,  -4,  -1,   2,
+         -4,  -1,   2,   5,
+         -1,   2,   5,   8,
+         -1,   2,   5,   8,
+         -4,  -1,   2,   5,
+         -7,  -4,  -1,   2,
+        -10,  -7,  -4,  -1,
+    },
+};
+
+#else
+
+// Default profile
+#define MCUMAX_PST_SQUARE(index) (index)
+
+static const int8_t mcumax_pst_mg[6][64] = {
+    // Pawn
+    {
+          0,   0,   0,   0,   0,   0,   0,   0,
+         10,  10,  10,  10,  10,   7,   7,   7,
+          8,   8,   8,   8,   8,   5,   5,   5,
+          6,   6,   9,  12,  12,   6,   3,   3,
+          4,   4,   7,  10,  10,   4,   1,   1,
+          2,   2,   3,   5,   5,   3,   2,   2,
+          0,   0,   0,   0,   0,   4,   4,   4,
+          0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    // Knight
+    {
+        -20, -15, -10,  -5,  -5, -10, -15, -20,
+        -15, -10,  -5,   0,   0,  -5, -10, -15,
+        -10,  -5,   0,   5,   5,   0,  -5, -10,
+         -5,   0,   5,  10,  10,   5,   0,  -5,
+         -5,   0,   5,  10,  10,   5,   0,  -5,
+        -10,  -5,   0,   5,   5,   0,  -5, -10,
+        -15, -10,  -5,   0,   0,  -5, -10, -15,
+        -20, -15, -10,  -5,  -5, -10, -15, -20,
+    },
+    // King
+    {
+        -40, -40, -40, -40, -40, -40, -40, -40,
+        -38, -38, -38, -38, -38, -38, -38, -38,
+        -32, -32, -32, -32, -32, -32, -32, -32,
+        -26, -26, -26, -26, -26, -26, -26, -26,
+        -20, -20, -20, -20, -20, -20, -20, -20,
+        -14, -14, -14, -14, -14, -14, -14, -14,
+          0,   2,  -4, -10, -10,  -6,   2,   0,
+          4,  10,   6,  -4,  -2,   0,  12,   6,
+    },
+    // Bishop
+    {
+         -6,  -4,  -2,   0,   0,  -2,  -4,  -6,
+         -4,  -2,   0,   2,   2,   0,  -2,  -4,
+         -2,   0,   2,   4,   4,   2,   0,  -2,
+          0,   2,   4,   6,   6,   4,   2,   0,
+          0,   2,   4,   6,   6,   4,   2,   0,
+         -2,   0,   2,   4,   4,   2,   0,  -2,
+         -4,  -2,   0,   2,   2,   0,  -2,  -4,
+         -6,  -4,  -2,   0,   0,  -2,  -4,  -6,
+    },
+    // Rook
+    {
+          0,   0,   0,   3,   3,   0,   0,   0,
+         10,  10,  10,  13,  13,  10,  10,  10,
+          0,   0,   0,   3,   3,   0,   0,   0,
+          0,   0,   0,   3,   3,   0,   0,   0,
+          0,   0,   0,   3,   3,   0,   0,   0,
+          0,   0,   0,   3,   3,   0,   0,   0,
+          0,   0,   0,   3,   3,   0,   0,   0,
+          0,   0,   0,   3,   3,   0,   0,   0,
+    },
+    // Queen
+    {
+         -4,  -3,  -2,  -1,  -1,  -2,  -3,  -4,
+         -3,  -2,  -1,   0,   0,  -1,  -2,  -3,
+         -2,  -1,   0,   1,   1,   0,  -1,  -2,
+         -1,   0,   1,   2,   2,   1,   0,  -1,
+         -1,   0,   1,   2,   2,   1,   0,  -1,
+         -2,  -1,   0,   1,   1,   0,  -1,  -2,
+         -3,  -2,  -1,   0,   0,  -1,  -2,  -3,
+         -4,  -3,  -2,  -1,  -1,  -2,  -3,  -4,
+    },
+};
+
+static const int8_t mcumax_pst_eg[6][64] = {
+    // Pawn
+    {
+          0,   0,   0,   0,   0,   0,   0,   0,
+         46,  46,  46,  46,  46,  46,  46,  46,
+         30,  30,  30,  30,  30,  30,  30,  30,
+         18,  18,  18,  18,  18,  18,  18,  18,
+         10,  10,  10,  10,  10,  10,  10,  10,
+          4,   4,   4,   4,   4,   4,   4,   4,
+          0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    // Knight
+    {
+        -12,  -9,  -6,  -3,  -3,  -6,  -9, -12,
+         -9,  -6,  -3,   0,   0,  -3,  -6,  -9,
+         -6,  -3,   0,   3,   3,   0,  -3,  -6,
+         -3,   0,   3,   6,   6,   3,   0,  -3,
+         -3,   0,   3,   6,   6,   3,   0,  -3,
+         -6,  -3,   0,   3,   3,   0,  -3,  -6,
+         -9,  -6,  -3,   0,   0,  -3,  -6,  -9,
+        -12,  -9,  -6,  -3,  -3,  -6,  -9, -12,
+    },
+    // King
+    {
+        -20, -14,  -8,  -2,  -2,  -8, -14, -20,
+        -14,  -8,  -2,   4,   4,  -2,  -8, -14,
+         -8,  -2,   4,  10,  10,   4,  -2,  -8,
+         -2,   4,  10,  16,  16,  10,   4,  -2,
+         -2,   4,  10,  16,  16,  10,   4,  -2,
+         -8,  -2,   4,  10,  10,   4,  -2,  -8,
+        -14,  -8,  -2,   4,   4,  -2,  -8, -14,
+        -20, -14,  -8,  -2,  -2,  -8, -14, -20,
+    },
+    // Bishop
+    {
+         -8,  -6,  -4,  -2,  -2,  -4,  -6,  -8,
+         -6,  -4,  -2,   0,   0,  -2,  -4,  -6,
+         -4,  -2,   0,   2,   2,   0,  -2,  -4,
+         -2,   0,   2,   4,   4,   2,   0,  -2,
+         -2,   0,   2,   4,   4,   2,   0,  -2,
+         -4,  -2,   0,   2,   2,   0,  -2,  -4,
+         -6,  -4,  -2,   0,   0,  -2,  -4,  -6,
+         -8,  -6,  -4,  -2,  -2,  -4,  -6,  -8,
+    },
+    // Rook
+    {
+          0,   0,   0,   0,   0,   0,   0,   0,
+          6,   6,   6,   6,   6,   6,   6,   6,
+          0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    // Queen
+    {
+        -10,  -7,  -4,  -1,  -1,  -4,  -7, -10,
+         -7,  -4,  -1,   2,   2,  -1,  -4,  -7,
+         -4,  -1,   2,   5,   5,   2,  -1,  -4,
+         -1,   2,   5,   8,   8,   5,   2,  -1,
+         -1,   2,   5,   8,   8,   5,   2,  -1,
+         -4,  -1,   2,   5,   5,   2,  -1,  -4,
+         -7,  -4,  -1,   2,   2,  -1,  -4,  -7,
+        -10,  -7,  -4,  -1,  -1,  -4,  -7, -10,
+    },
+};
+
+#endif
+
+// Pawn structure, white's view: penalties per pawn, passed pawn bonus by row
+// (rank 8 first), king shelter by shield pawn (none, one rank, two ranks ahead)
+#define MCUMAX_PAWN_DOUBLED_MG -8
+#define MCUMAX_PAWN_DOUBLED_EG -16
+#define MCUMAX_PAWN_ISOLATED_MG -8
+#define MCUMAX_PAWN_ISOLATED_EG -10
+
+static const int8_t mcumax_pawn_passed_mg[8] = {
+    0, 45, 30, 18, 10, 5, 3, 0};
+static const int8_t mcumax_pawn_passed_eg[8] = {
+    0, 90, 60, 36, 20, 12, 8, 0};
+static const int8_t mcumax_king_shelter_mg[3] = {
+    -8, 8, 4};
+
+// Search bonus for castling moves
+#define MCUMAX_CASTLING_BONUS 50
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * mcu-max
+ * Chess game engine for low-resource MCUs
+ *
+ * (C) 2022-2024 Gissio
+ *
+ * License: MIT
+ *
+ * Hash scramble table, constant so it can stay in flash. Generated by an
+ * xorshift32 sequence seeded with 0x2545f491; entries up to the board mask
+ * (empty squares) are zero. Keys must match across hosts and hash files.
+ */
+
+#if !defined(MCU_MAX_SCRAMBLE_H)
+#define MCU_MAX_SCRAMBLE_H
+
+#include <stdint.h>
+
+#define MCUMAX_HASH_SCRAMBLE_TABLE_SIZE 1035
+
+static const uint8_t mcumax_scramble_table[MCUMAX_HASH_SCRAMBLE_TABLE_SIZE] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7f, 0x7f, 0xe2, 0xa3, 0xc9, 0xd6, 0xae,
+    0x2a, 0x67, 0x66, 0xed, 0xab, 0xb5, 0x4d, 0x73, 0xff, 0x96, 0x8a, 0x23, 0x32, 0x0b, 0x97, 0xef,
+    0x1c, 0x7d, 0xba, 0x41, 0x96, 0x78, 0xf9, 0xd2, 0x69, 0x3c, 0xb3, 0x6f, 0xcb, 0xdb, 0x42, 0x74,
+    0xe1, 0x81, 0x5f, 0x22, 0xd7, 0x1b, 0x25, 0xa7, 0xce, 0xf6, 0xcb, 0x80, 0xa1, 0x1e, 0xaa, 0xad,
+    0xdf, 0x1d, 0xb0, 0xe8, 0x22, 0xd1, 0x5e, 0x04, 0x2a, 0x20, 0x70, 0x63, 0x1f, 0x88, 0xba, 0xad,
+    0x83, 0x6a, 0x92, 0x5b, 0xdb, 0xdb, 0xc7, 0xef, 0x87, 0xfb, 0x15, 0xec, 0xa5, 0xb8, 0x96, 0x9f,
+    0x15, 0x49, 0x63, 0x80, 0x9c, 0xc9, 0x86, 0x33, 0xcd, 0x05, 0x2c, 0x3d, 0x42, 0x6b, 0xb3, 0xfc,
+    0x49, 0x2a, 0xc5, 0x02, 0x21, 0xec, 0x42, 0x96, 0xd0, 0x72, 0x13, 0x3f, 0x59, 0x28, 0x48, 0xc6,
+    0xf9, 0xab, 0xeb, 0xe1, 0x86, 0x01, 0xed, 0x68, 0xaf, 0x6f, 0x05, 0x51, 0xb3, 0x7a, 0xeb, 0x7e,
+    0xd1, 0xf0, 0x9b, 0xc4, 0x54, 0xbc, 0xa6, 0x8c, 0x44, 0xee, 0xc6, 0xf5, 0x29, 0xe9, 0x6f, 0xd3,
+    0xa9, 0x78, 0x32, 0xd0, 0x9a, 0x6d, 0xdd, 0x69, 0x83, 0xde, 0x33, 0x08, 0x23, 0x9b, 0x13, 0xa9,
+    0x48, 0x08, 0x68, 0x89, 0x1d, 0xb6, 0xa4, 0x39, 0xba, 0x75, 0xe8, 0xb0, 0x2c, 0x5d, 0x2c, 0x09,
+    0x52, 0x2d, 0x46, 0xc1, 0x37, 0x58, 0x52, 0x13, 0x59, 0x99, 0xd9, 0x86, 0xa2, 0x36, 0xb7, 0x1b,
+    0x79, 0x38, 0xf2, 0xcc, 0xf6, 0x84, 0x62, 0x01, 0xa8, 0x0c, 0x05, 0xab, 0xb6, 0xf5, 0xf8, 0x00,
+    0x41, 0xab, 0x05, 0x89, 0xa5, 0x91, 0x92, 0x06, 0x54, 0xcc, 0xd8, 0xbb, 0x9d, 0x92, 0x65, 0xf9,
+    0xfc, 0x57, 0x32, 0x2c, 0x17, 0x2f, 0x1d, 0xd0, 0xcf, 0x52, 0x7d, 0xde, 0xe4, 0xcd, 0x18, 0x90,
+    0xf2, 0x4b, 0x98, 0x87, 0x8e, 0x59, 0x20, 0x80, 0x73, 0x8a, 0xea, 0x87, 0xdf, 0x30, 0xbd, 0xe4,
+    0xb8, 0x70, 0x6a, 0x4d, 0xb8, 0x53, 0xaa, 0xdd, 0x34, 0x96, 0xc0, 0x75, 0xe9, 0xc9, 0xf2, 0x60,
+    0xbd, 0x1b, 0x75, 0x60, 0xf5, 0x83, 0x3a, 0x0f, 0xca, 0x8a, 0x7a, 0x16, 0xae, 0x0a, 0x2b, 0xfe,
+    0x6e, 0xe9, 0xae, 0xd5, 0x52, 0x4e, 0x76, 0x92, 0xaa, 0xa5, 0x3a, 0x74, 0x2b, 0xd7, 0xae, 0xa6,
+    0x56, 0xef, 0x03, 0x51, 0x5b, 0xe8, 0xa5, 0x39, 0xfb, 0xfe, 0x4e, 0x90, 0x66, 0x44, 0x5a, 0xd3,
+    0xbb, 0xf5, 0xb7, 0x63, 0x9c, 0x49, 0xaa, 0xe3, 0x75, 0x64, 0x03, 0x60, 0x9d, 0xa5, 0xa7, 0xad,
+    0x70, 0x5b, 0xd9, 0x62, 0x94, 0x86, 0x54, 0xca, 0x22, 0xf0, 0xd5, 0xdc, 0x7f, 0x88, 0x20, 0xe9,
+    0x8d, 0x35, 0x67, 0xb6, 0x4b, 0xe1, 0x99, 0x40, 0x19, 0x26, 0x21, 0x39, 0x32, 0x26, 0x8e, 0x83,
+    0x53, 0xc2, 0x5a, 0xd5, 0x1f, 0x40, 0x0f, 0xa2, 0xc4, 0xa5, 0xf1, 0xef, 0x5b, 0x6a, 0xa2, 0xb8,
+    0x2d, 0x5b, 0xf1, 0x0c, 0x4f, 0xa1, 0xaa, 0x5e, 0x72, 0x14, 0x02, 0xb6, 0x30, 0xd5, 0x31, 0x0b,
+    0xab, 0xbd, 0x11, 0xe9, 0x4a, 0xde, 0x8e, 0x0c, 0x8c, 0xa0, 0xdf, 0x99, 0x46, 0x77, 0xb3, 0x2b,
+    0x78, 0x45, 0xdc, 0x1e, 0x10, 0xf4, 0x63, 0x5c, 0xab, 0x4a, 0x5c, 0xef, 0x6b, 0x14, 0x92, 0x72,
+    0x7e, 0x78, 0xfc, 0xe6, 0x0a, 0x78, 0x09, 0xad, 0xc3, 0xfe, 0x28, 0x3b, 0x2f, 0x94, 0xee, 0xe4,
+    0xa1, 0x28, 0xae, 0xae, 0xa3, 0xd4, 0x8b, 0x46, 0xb3, 0xec, 0x73, 0x5b, 0xeb, 0xc2, 0xe3, 0x99,
+    0xdc, 0x44, 0x99, 0xb8, 0xf0, 0x41, 0x84, 0x5b, 0x25, 0xa3, 0x70, 0xa0, 0x5d, 0x7a, 0x02, 0xeb,
+    0x68, 0x4c, 0x08, 0x3f, 0x2b, 0x0d, 0x45, 0x96, 0x9f, 0x67, 0xff, 0x9a, 0x54, 0xc6, 0x97, 0xbd,
+    0x4f, 0xb8, 0xf2, 0x68, 0xeb, 0x23, 0x1f, 0xc8, 0x28, 0x29, 0xfd, 0xa8, 0x26, 0xe1, 0xfd, 0xae,
+    0x8a, 0x9a, 0x8d, 0x71, 0x7d, 0xa8, 0xf8, 0x51, 0xdc, 0xa7, 0xe5, 0x03, 0x72, 0xf1, 0x31, 0x3b,
+    0x99, 0x78, 0x6f, 0xd0, 0x71, 0x4d, 0x8e, 0x1c, 0x24, 0xd3, 0xf7, 0x1d, 0xff, 0x9d, 0x37, 0x35,
+    0x24, 0x81, 0xcd, 0x39, 0xfe, 0xa9, 0x8c, 0x18, 0x5c, 0x74, 0x26, 0x6a, 0x80, 0x27, 0x5a, 0x57,
+    0xe4, 0xad, 0x09, 0x2f, 0xfa, 0x3a, 0x6f, 0x64, 0x99, 0xde, 0x02, 0x7e, 0xb4, 0x8f, 0x4e, 0x28,
+    0x9a, 0x85, 0x56, 0x3b, 0xaf, 0x02, 0xc4, 0x01, 0x39, 0xde, 0x89, 0x26, 0x39, 0x82, 0xa5, 0xe8,
+    0x76, 0x7d, 0xa2, 0xc7, 0x3a, 0x35, 0x17, 0xc6, 0x5d, 0x29, 0x94, 0x83, 0x8b, 0x8b, 0xdd, 0x60,
+    0xda, 0xee, 0x5b, 0x80, 0x51, 0x4d, 0xbf, 0x3f, 0x0e, 0xc5, 0x72, 0xbb, 0xbb, 0x88, 0xd6, 0x68,
+    0xdc, 0xed, 0x54, 0x42, 0xf8, 0x83, 0xdd, 0xdc, 0xd1, 0x0f, 0x33, 0xda, 0x53, 0x6f, 0xcf, 0xa2,
+    0x9e, 0xa7, 0xe7, 0xec, 0xe1, 0x76, 0xfc, 0x51, 0xee, 0xee, 0xb9, 0x5d, 0xbe, 0x2d, 0x5e, 0x49,
+    0x58, 0x5e, 0xb0, 0x8a, 0x74, 0x8f, 0x0e, 0xfd, 0x8d, 0xdc, 0x98, 0x17, 0x1a, 0x3d, 0x99, 0x01,
+    0x04, 0x91, 0xd0, 0xd7, 0x62, 0xb1, 0xd3, 0x61, 0x69, 0x56, 0x92, 0x88, 0x3e, 0x79, 0x63, 0x1f,
+    0x57, 0x39, 0x09, 0x05, 0xea, 0xab, 0x82, 0xbd, 0x3c, 0x3b, 0xc7, 0x4c, 0x0a, 0x94, 0xa0, 0x4b,
+    0x89, 0xe5, 0x24, 0xcd, 0x16, 0x4a, 0x82, 0xe0, 0x22, 0x74, 0xfe, 0x5b, 0x04, 0x1b, 0x64, 0x2f,
+    0x55, 0xb6, 0xe6, 0xe9, 0x2e, 0x56, 0x8c, 0x9f, 0xd5, 0x48, 0xda, 0x34, 0x72, 0xca, 0x8a, 0x9e,
+    0xf5, 0x7a, 0x3c, 0x53, 0x24, 0xe6, 0x3d, 0x75, 0xfd, 0x2b, 0x47, 0x08, 0x0b, 0x9f, 0x13, 0x28,
+    0x52, 0x08, 0x51, 0xe2, 0x29, 0x46, 0x4e, 0xe9, 0x9d, 0xaa, 0x0d, 0xfb, 0x19, 0x97, 0x8e, 0xc9,
+    0x0c, 0xa0, 0xb9, 0x7f, 0x99, 0xab, 0x59, 0x68, 0x93, 0xd0, 0xf2, 0x4b, 0x96, 0x83, 0xfe, 0x19,
+    0xa5, 0x84, 0xe7, 0xd8, 0xac, 0x55, 0x3e, 0xec, 0xfe, 0x73, 0x84, 0xb7, 0xf7, 0x4d, 0x6d, 0x3e,
+    0x20, 0x7e, 0xb3, 0x8f, 0xdd, 0xb1, 0x7d, 0x6c, 0xc1, 0xd8, 0x5c, 0x5d, 0x57, 0x9b, 0x58, 0x2d,
+    0x95, 0xdf, 0x02, 0x2d, 0xe0, 0x89, 0xef, 0x02, 0xe9, 0xc6, 0xd6, 0xbc, 0x50, 0x88, 0x58, 0x08,
+    0x69, 0x5f, 0xcc, 0xb0, 0x7e, 0x6d, 0x29, 0x11, 0xdf, 0xf6, 0xff, 0x93, 0x58, 0x1f, 0x20, 0xa9,
+    0xdc, 0x2c, 0xfa, 0xdc, 0xbe, 0x4d, 0xf0, 0xba, 0x0b, 0xc7, 0x7b, 0x86, 0xfb, 0x59, 0x0f, 0xed,
+    0xc6, 0xe1, 0x15, 0x7a, 0x73, 0x41, 0xa0, 0xa5, 0x01, 0x44, 0xf5, 0x3b, 0x8e, 0x9e, 0x23, 0x82,
+    0xb5, 0x3b, 0x1d, 0x22, 0xf2, 0x78, 0xfa, 0xc1, 0x7a, 0x66, 0x08,
+};
+
+#endif
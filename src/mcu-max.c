@@ -10,22 +10,139 @@
  * Compliant with FIDE laws (except for underpromotion).
  */
 
+#include <limits.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "mcu-max.h"
 
+#if defined(MCUMAX_HASH_FILES) && defined(MCUMAX_HASHING_ENABLED) && (defined(__unix__) || defined(__APPLE__))
+#define MCUMAX_HASH_MMAP // Load hash files zero-copy
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(MCUMAX_EVAL_TABLES)
+#include MCUMAX_EVAL_TABLES
+#else
+#include "mcu-max-eval.h"
+#endif
+#include "mcu-max-scramble.h"
+#if defined(MCUMAX_BITBOARDS)
+#include "mcu-max-masks.h"
+#endif
+
+#if defined(MCUMAX_BITBOARDS) && defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(MCUMAX_BITBOARDS) && defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 // Configuration
 // #define MCUMAX_HASHING_ENABLED
+// #define MCUMAX_HASH_COMPACT // 6-byte hash entries, for small MCU tables
+// #define MCUMAX_HASH_FILES // Saving and loading the hash table (stdio), for hosts
+// #define MCUMAX_BITBOARDS // Piece bitboards, for 64-bit hosts
+// #define MCUMAX_ROOT_MOVES // Root move list: node count ordering, search moves, root move scores
+// #define MCUMAX_MATE_SEARCH // Mate-in-N solver (mcumax_search_mate)
+// #define MCUMAX_EVAL_API // Evaluation with given parameters, for tuning on hosts
+
+#if !defined(MCUMAX_PLY_MAX)
+#define MCUMAX_PLY_MAX 12 // Node stack size, sized for small MCUs
+#endif
+
+#if !defined(MCUMAX_PAWN_HASH_SIZE)
+#define MCUMAX_PAWN_HASH_SIZE 0 // Pawn hash entries, power of two (0: evaluate directly)
+#endif
+
+#ifdef MCUMAX_ROOT_MOVES
+#if !defined(MCUMAX_ROOT_MOVES_MAX)
+#define MCUMAX_ROOT_MOVES_MAX 128 // Root move list size
+#endif
+#if !defined(MCUMAX_ROOT_SCORES_WINDOW)
+#define MCUMAX_ROOT_SCORES_WINDOW 20 // Aspiration window when scoring root moves
+#endif
+#endif
+
+#define MCUMAX_HALFMOVE_DRAW 100 // Fifty-move rule
+
+#if !defined(MCUMAX_HISTORY_GAME_MAX)
+#define MCUMAX_HISTORY_GAME_MAX 16 // Game positions kept for repetitions, sized for small MCUs
+#endif
+#if MCUMAX_HISTORY_GAME_MAX > 255
+#error "MCUMAX_HISTORY_GAME_MAX must not exceed 255"
+#endif
+
+// Game positions, search plies and a quiescence reply
+#define MCUMAX_HISTORY_SIZE (MCUMAX_HISTORY_GAME_MAX + MCUMAX_PLY_MAX + 1)
+
+// Late move reductions: R = base + ln(depth) * ln(moves) / divisor
+#if !defined(MCUMAX_LMR_DEPTH_MIN)
+#define MCUMAX_LMR_DEPTH_MIN 3 // Min. full-width depth to reduce at
+#endif
+#if !defined(MCUMAX_LMR_MOVES_MIN)
+#define MCUMAX_LMR_MOVES_MIN 3 // Moves searched before reducing
+#endif
+#if !defined(MCUMAX_LMR_BASE)
+#define MCUMAX_LMR_BASE 75 // 1/100 ply
+#endif
+#if !defined(MCUMAX_LMR_DIVISOR)
+#define MCUMAX_LMR_DIVISOR 225 // 1/100
+#endif
+
+// Null-move pruning: R = base + depth / divisor + (eval - beta) / margin
+#if !defined(MCUMAX_NULL_MOVE_BASE)
+#define MCUMAX_NULL_MOVE_BASE 2
+#endif
+#if !defined(MCUMAX_NULL_MOVE_DIVISOR)
+#define MCUMAX_NULL_MOVE_DIVISOR 6
+#endif
+#if !defined(MCUMAX_NULL_MOVE_MARGIN)
+#define MCUMAX_NULL_MOVE_MARGIN 150
+#endif
+#if !defined(MCUMAX_NULL_MOVE_VERIFY_DEPTH)
+#define MCUMAX_NULL_MOVE_VERIFY_DEPTH 10 // Min. depth to verify fail highs at
+#endif
+
+// Quiescence search: captures only, in MVV/LVA order
+#if !defined(MCUMAX_QUIESCENCE_PLY_MAX)
+#define MCUMAX_QUIESCENCE_PLY_MAX 4 // Max. capture sequence length (C stack), sized for small MCUs
+#endif
+#if !defined(MCUMAX_QUIESCENCE_MOVES_MAX)
+#define MCUMAX_QUIESCENCE_MOVES_MAX (16 * MCUMAX_QUIESCENCE_PLY_MAX) // Move list size, all plies
+#endif
+#if !defined(MCUMAX_QUIESCENCE_DELTA_MARGIN)
+#define MCUMAX_QUIESCENCE_DELTA_MARGIN 150 // Delta pruning margin
+#endif
+
+// Integer profile: MCUMAX_NARROW_INTEGERS keeps scores in 16 bits, for 8- and
+// 16-bit MCUs, where it is the default. Search scores stay within +-MCUMAX_SCORE_MAX
+#if !defined(MCUMAX_NARROW_INTEGERS) && (INT_MAX <= INT16_MAX)
+#define MCUMAX_NARROW_INTEGERS
+#endif
+#if defined(MCUMAX_NARROW_INTEGERS)
+typedef int16_t mcumax_score;
+#else
+typedef int32_t mcumax_score;
+#endif
 
 // Constants
 #define MCUMAX_BOARD_MASK 0x88
 #define MCUMAX_BOARD_WHITE 0x8
 #define MCUMAX_BOARD_BLACK 0x10
 #define MCUMAX_PIECE_MOVED 0x20
-#define MCUMAX_SCORE_MAX 8000
+#define MCUMAX_SCORE_STATIC_MAX (MCUMAX_SCORE_MAX - 1000) // Margin for captures within a search
 #define MCUMAX_DEPTH_MAX 99
+#define MCUMAX_PHASE_ENDGAME (MCUMAX_PHASE_MAX / 4)
+#define MCUMAX_LMR_DEPTH_NUM 16
+#define MCUMAX_LMR_MOVES_NUM 32
+
+// 0x88 square to 0-63 index
+#define MCUMAX_SQUARE_INDEX(square) ((((square) & 0x70) >> 1) | ((square) & 0x7))
 
 enum mcumax_mode
 {
@@ -35,21 +152,117 @@ enum mcumax_mode
     MCUMAX_PLAY_MOVE,
 };
 
-struct
+enum mcumax_node_state
+{
+    MCUMAX_NODE_ENTER,
+    MCUMAX_NODE_NULL_MOVE,
+    MCUMAX_NODE_NULL_MOVE_VERIFY,
+    MCUMAX_NODE_REPLY,
+};
+
+// Search node, kept on the node stack while its children are searched
+struct mcumax_node
+{
+    mcumax_score alpha;
+    mcumax_score beta;
+    mcumax_score score;
+    uint8_t en_passant_square;
+    uint8_t depth;
+    uint8_t mode;
+    uint8_t state;
+
+    uint8_t iter_depth;
+    mcumax_score iter_score;
+    uint8_t iter_square_from;
+    uint8_t iter_square_to;
+
+#ifdef MCUMAX_HASHING_ENABLED
+    int32_t hash_key;
+    struct HashBucket *hash_bucket;
+#endif
+    int32_t hash_key2;
+    uint16_t halfmove_clock;
+
+    int16_t eval_mg;
+    int16_t eval_eg;
+    uint8_t phase;
+    uint16_t side_phases;
+    int16_t pawn_mg;
+    int16_t pawn_eg;
+    uint32_t pawn_key;
+    uint8_t in_check;
+
+    uint8_t square_start;
+    uint8_t square_from;
+    uint8_t square_to;
+    uint8_t replay_move;
+    mcumax_score null_move_score;
+
+    uint8_t scan_piece;
+    uint8_t scan_piece_type;
+    int8_t step_vector;
+    int8_t step_vector_index;
+
+    uint8_t castling_skip_square;
+    uint8_t castling_rook_square;
+    uint8_t capture_square;
+    uint8_t capture_piece;
+    mcumax_score capture_piece_value;
+
+    uint8_t step_depth;
+    mcumax_score step_alpha;
+    mcumax_score step_beta;
+    mcumax_score step_score;
+    uint8_t move_index;
+
+#ifdef MCUMAX_TRACE
+    uint8_t trace_flags;   // Node outcome
+    uint8_t trace_replies; // Searches of current move
+#endif
+};
+
+struct mcumax_state
 {
+    // Position, board to history_keys: saved as one block by mate search
+
     // Board: first half of 16x8 + dummy
     uint8_t board[0x80 + 1];
     uint8_t current_side;
 
+    // King squares: white, black
+    uint8_t king_squares[2];
+
+#ifdef MCUMAX_BITBOARDS
+    // Piece bitboards: white, black
+    uint64_t bitboards[2];
+#endif
+
     // Engine
-    int32_t score;
+    mcumax_score score;
     uint8_t en_passant_square;
-    int32_t non_pawn_material;
+
+    // Evaluation: piece-square sums (white's view), game phase
+    int16_t eval_mg;
+    int16_t eval_eg;
+    uint8_t phase;
+    uint16_t side_phases; // Phase of white (low byte), black (high byte) pieces
+
+    // Pawn structure and king shelter (white's view), key of pawns and kings
+    int16_t pawn_mg;
+    int16_t pawn_eg;
+    uint32_t pawn_key;
 
 #ifdef MCUMAX_HASHING_ENABLED
     uint32_t hash_key;
-    uint32_t hash_key2;
 #endif
+    uint32_t hash_key2; // Also keys the position history
+
+    // Position history: keys since the last capture or pawn move;
+    // game positions, then one per search ply
+    uint16_t halfmove_clock;
+    uint16_t fullmove_number;
+    uint8_t history_num; // Game positions
+    uint32_t history_keys[MCUMAX_HISTORY_SIZE];
 
     // Interface
     uint8_t square_from; // Selected move
@@ -57,10 +270,20 @@ struct
 
     uint32_t node_count;
     uint32_t node_max;
-    uint32_t depth_max;
+    uint8_t depth_max;
 
     bool stop_search;
 
+    // Node stack
+    struct mcumax_node stack[MCUMAX_PLY_MAX];
+    uint8_t ply;
+    mcumax_move killer_moves[MCUMAX_PLY_MAX]; // Quiet moves that failed high
+    uint8_t null_move_ply_min;                // No null moves below (verification)
+    mcumax_score search_score;
+    bool search_done;
+    mcumax_move best_move;
+    uint8_t best_move_depth; // Of last completed iteration
+
     // Extra
     mcumax_callback user_callback;
     void *user_data;
@@ -68,6 +291,40 @@ struct
     mcumax_move *valid_moves_buffer;
     uint32_t valid_moves_buffer_size;
     uint32_t valid_moves_num;
+
+    // MultiPV lines, best first
+    mcumax_scored_move *multipv_buffer;
+    uint32_t multipv_buffer_size;
+    uint32_t multipv_num;      // Lines in buffer
+    uint32_t multipv_pass;     // Lines found at current depth
+    uint8_t multipv_square_to; // Best line, with replay flag
+
+#ifdef MCUMAX_ROOT_MOVES
+    // Root move list, ordered by subtree node count
+    mcumax_move root_moves[MCUMAX_ROOT_MOVES_MAX];
+    uint32_t root_move_node_counts[MCUMAX_ROOT_MOVES_MAX];
+    uint32_t root_moves_num;
+    uint32_t root_move_index;
+    uint32_t root_move_node_mark;
+    bool root_moves_restricted;
+
+    // Root move scores (mcumax_score_root_moves): exact score of every root move
+    int16_t root_move_scores[MCUMAX_ROOT_MOVES_MAX]; // Last searched
+    mcumax_scored_move *root_scores_buffer;          // Last completed iteration, best first
+    uint32_t root_scores_buffer_size;
+    uint32_t root_scores_num;
+
+    const mcumax_move *search_moves; // For next search
+    uint32_t search_moves_num;
+#endif
+
+#ifdef MCUMAX_TRACE
+    // Search trace ring
+    mcumax_trace_record *trace_buffer;
+    uint32_t trace_buffer_size;
+    uint32_t trace_count;
+    uint8_t trace_flags; // Outcome of last child node
+#endif
 } mcumax;
 
 static const int8_t mcumax_capture_values[] = {
@@ -97,818 +354,3736 @@ static const int8_t mcumax_board_setup[] = {
     MCUMAX_ROOK,
 };
 
-#ifdef MCUMAX_HASHING_ENABLED
+// Attack flags: piece types that can attack along a square difference
+enum
+{
+    MCUMAX_ATTACK_PAWN_UPSTREAM = 0x1,
+    MCUMAX_ATTACK_PAWN_DOWNSTREAM = 0x2,
+    MCUMAX_ATTACK_KNIGHT = 0x4,
+    MCUMAX_ATTACK_KING = 0x8,
+    MCUMAX_ATTACK_DIAGONAL = 0x10,
+    MCUMAX_ATTACK_ORTHOGONAL = 0x20,
+};
+
+static const uint8_t mcumax_attack_piece_flags[] = {
+    0,
+    MCUMAX_ATTACK_PAWN_UPSTREAM,
+    MCUMAX_ATTACK_PAWN_DOWNSTREAM,
+    MCUMAX_ATTACK_KNIGHT,
+    MCUMAX_ATTACK_KING,
+    MCUMAX_ATTACK_DIAGONAL,
+    MCUMAX_ATTACK_ORTHOGONAL,
+    MCUMAX_ATTACK_DIAGONAL | MCUMAX_ATTACK_ORTHOGONAL,
+};
 
-#define MCUMAX_HASH_SCRAMBLE_TABLE_SIZE 1035
-#define MCUMAX_HASH_TABLE_SIZE (1 << 24)
+// 0x88 difference tables, indexed by to - from + 0x77:
+// attack flags of a piece on from attacking to, and its ray step
+#define MCUMAX_ATTACK_INDEX(square_from, square_to) ((square_to) - (square_from) + 0x77)
+
+static const uint8_t mcumax_attack_types[] = {
+    16, 0, 0, 0, 0, 0, 0, 32, 0, 0, 0, 0, 0, 0, 16, 0,
+    0, 16, 0, 0, 0, 0, 0, 32, 0, 0, 0, 0, 0, 16, 0, 0,
+    0, 0, 16, 0, 0, 0, 0, 32, 0, 0, 0, 0, 16, 0, 0, 0,
+    0, 0, 0, 16, 0, 0, 0, 32, 0, 0, 0, 16, 0, 0, 0, 0,
+    0, 0, 0, 0, 16, 0, 0, 32, 0, 0, 16, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 16, 4, 32, 4, 16, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 4, 25, 40, 25, 4, 0, 0, 0, 0, 0, 0,
+    32, 32, 32, 32, 32, 32, 40, 0, 40, 32, 32, 32, 32, 32, 32, 0,
+    0, 0, 0, 0, 0, 4, 26, 40, 26, 4, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 16, 4, 32, 4, 16, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 16, 0, 0, 32, 0, 0, 16, 0, 0, 0, 0, 0,
+    0, 0, 0, 16, 0, 0, 0, 32, 0, 0, 0, 16, 0, 0, 0, 0,
+    0, 0, 16, 0, 0, 0, 0, 32, 0, 0, 0, 0, 16, 0, 0, 0,
+    0, 16, 0, 0, 0, 0, 0, 32, 0, 0, 0, 0, 0, 16, 0, 0,
+    16, 0, 0, 0, 0, 0, 0, 32, 0, 0, 0, 0, 0, 0, 16,
+};
+
+static const int8_t mcumax_attack_steps[] = {
+    -17, 0, 0, 0, 0, 0, 0, -16, 0, 0, 0, 0, 0, 0, -15, 0,
+    0, -17, 0, 0, 0, 0, 0, -16, 0, 0, 0, 0, 0, -15, 0, 0,
+    0, 0, -17, 0, 0, 0, 0, -16, 0, 0, 0, 0, -15, 0, 0, 0,
+    0, 0, 0, -17, 0, 0, 0, -16, 0, 0, 0, -15, 0, 0, 0, 0,
+    0, 0, 0, 0, -17, 0, 0, -16, 0, 0, -15, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, -17, 0, -16, 0, -15, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, -17, -16, -15, 0, 0, 0, 0, 0, 0, 0,
+    -1, -1, -1, -1, -1, -1, -1, 0, 1, 1, 1, 1, 1, 1, 1, 0,
+    0, 0, 0, 0, 0, 0, 15, 16, 17, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 15, 0, 16, 0, 17, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 15, 0, 0, 16, 0, 0, 17, 0, 0, 0, 0, 0,
+    0, 0, 0, 15, 0, 0, 0, 16, 0, 0, 0, 17, 0, 0, 0, 0,
+    0, 0, 15, 0, 0, 0, 0, 16, 0, 0, 0, 0, 17, 0, 0, 0,
+    0, 15, 0, 0, 0, 0, 0, 16, 0, 0, 0, 0, 0, 17, 0, 0,
+    15, 0, 0, 0, 0, 0, 0, 16, 0, 0, 0, 0, 0, 0, 17,
+};
 
-#define HashScramble(A, B)                \
-    *(uint32_t *)(mcumax_scramble_table + \
-                  A + (B & 8) + MCUMAX_SQUARE_INVALID * (B & 0b111))
+// Position keys: sums of scramble values of the pieces
+#define HashScramble(A, B) \
+    mcumax_scramble((A) + ((B) & 8) + MCUMAX_SQUARE_INVALID * ((B) & 0b111))
 #define Hash(A)                                                      \
-    HashScramble(step_square_to + A, mcumax.board[step_square_to]) - \
-        HashScramble(scan_square_from + A, scan_piece) -             \
+    HashScramble(square_to + A, mcumax.board[square_to]) - \
+        HashScramble(square_from + A, scan_piece) -        \
         HashScramble(capture_square + A, capture_piece)
 
-static uint8_t mcumax_scramble_table[MCUMAX_HASH_SCRAMBLE_TABLE_SIZE]; /* hash translation table */
-
-struct HashEntry
+// Reads 32 scramble bits at any byte offset (no unaligned access on Cortex-M0)
+static uint32_t mcumax_scramble(uint32_t index)
 {
-    uint32_t key2;
-    int32_t score;
-    uint8_t square_from;
-    uint8_t square_to;
-    uint8_t depth;
-};
+    uint32_t value;
+    memcpy(&value, mcumax_scramble_table + index, sizeof(value));
+
+    return value;
+}
+
+#ifdef MCUMAX_HASHING_ENABLED
+
+#define MCUMAX_HASH_AGE_WEIGHT 4 // Depth lost per search generation of age
 
-static struct HashEntry mcumax_hash_table[MCUMAX_HASH_TABLE_SIZE];
+#if defined(MCUMAX_HASH_COMPACT)
 
+#if !defined(MCUMAX_HASH_TABLE_SIZE)
+#define MCUMAX_HASH_TABLE_SIZE 256 // Entries, power of two
 #endif
+#define MCUMAX_HASH_BUCKET_SIZE 4 // Entries per 24-byte bucket
 
-typedef bool (*mcumax_move_callback)(mcumax_move move);
+#define MCUMAX_HASH_ALIGNED
+#define MCUMAX_HASH_PREFETCH(address)
 
-static int32_t mcumax_search(int32_t alpha,
-                             int32_t beta,
-                             int32_t score,
-                             uint8_t en_passant_square,
-                             uint8_t depth,
-                             enum mcumax_mode mode);
-
-// Recursive minimax search
-// (alpha,beta)=window, score=current evaluation score, en_passant_square=e.p. sqr.
-// depth=depth, in_root=in_root; returns score
-static int32_t mcumax_search(int32_t alpha,
-                             int32_t beta,
-                             int32_t score,
-                             uint8_t en_passant_square,
-                             uint8_t depth,
-                             enum mcumax_mode mode)
+#define MCUMAX_HASH_KEY(key2) ((uint16_t)((uint32_t)(key2) >> 20))
+#define MCUMAX_HASH_DEPTH_MAX 15
+#define MCUMAX_HASH_GENERATION_MASK 0x7
+#define MCUMAX_HASH_SQUARE(index) ((((index) & 0x38) << 1) | ((index) & 0x7))
+
+// Packed entry, 6 bytes: 12 bits of key2 and depth (saturated); score and
+// bound flags; best move, replay flag and search generation
+struct HashEntry
 {
-    if (mcumax.user_callback)
-        mcumax.user_callback(mcumax.user_data);
+    uint16_t key_depth;   // key:12, depth:4
+    int16_t score_bound;  // score:14, bound:2
+    uint16_t move;        // from:6, to:6, replay:1, generation:3
+};
 
-    uint8_t iter_depth;
-    int32_t iter_score;
-    uint8_t iter_square_from;
-    uint8_t iter_square_to;
+#define MCUMAX_HASH_ENTRY_KEY(entry) ((entry)->key_depth >> 4)
+#define MCUMAX_HASH_ENTRY_DEPTH(entry) ((entry)->key_depth & 0xf)
+#define MCUMAX_HASH_ENTRY_GENERATION(entry) ((entry)->move >> 13)
 
-#ifdef MCUMAX_HASHING_ENABLED
-    int32_t hash_key;
-    int32_t hash_key2;
+#else
+
+#if !defined(MCUMAX_HASH_TABLE_SIZE)
+#define MCUMAX_HASH_TABLE_SIZE (1 << 24) // Entries, power of two
 #endif
+#define MCUMAX_HASH_BUCKET_SIZE 8 // Entries per 64-byte bucket
 
-    uint8_t square_start;
+#if defined(__GNUC__)
+#define MCUMAX_HASH_ALIGNED __attribute__((aligned(64)))
+#define MCUMAX_HASH_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define MCUMAX_HASH_ALIGNED
+#define MCUMAX_HASH_PREFETCH(address)
+#endif
+
+#define MCUMAX_HASH_KEY(key2) ((uint16_t)((uint32_t)(key2) >> 16))
+#define MCUMAX_HASH_DEPTH_MAX MCUMAX_DEPTH_MAX
+#define MCUMAX_HASH_GENERATION_MASK 0xff
 
+// Packed entry: upper half of key2, score, best move, depth, search generation
+struct HashEntry
+{
+    uint16_t key;
+    int16_t score;
     uint8_t square_from;
     uint8_t square_to;
+    uint8_t depth;
+    uint8_t generation;
+};
 
-    uint8_t replay_move;
-    int32_t null_move_score;
+#define MCUMAX_HASH_ENTRY_KEY(entry) ((entry)->key)
+#define MCUMAX_HASH_ENTRY_DEPTH(entry) ((entry)->depth)
+#define MCUMAX_HASH_ENTRY_GENERATION(entry) ((entry)->generation)
 
-    uint8_t scan_piece;
-    uint8_t scan_piece_type;
+#endif
 
-    int8_t step_vector;
-    int8_t step_vector_index;
+#if (MCUMAX_HASH_TABLE_SIZE < MCUMAX_HASH_BUCKET_SIZE) || \
+    (MCUMAX_HASH_TABLE_SIZE & (MCUMAX_HASH_TABLE_SIZE - 1))
+#error "MCUMAX_HASH_TABLE_SIZE must be a power of two of at least one bucket"
+#endif
 
-    uint8_t castling_skip_square;
-    uint8_t castling_rook_square;
+#define MCUMAX_HASH_BUCKET_NUM (MCUMAX_HASH_TABLE_SIZE / MCUMAX_HASH_BUCKET_SIZE)
 
-    uint8_t capture_square;
-    uint8_t capture_piece;
-    int32_t capture_piece_value;
+// One cache line (full entries)
+struct HashBucket
+{
+    struct HashEntry entries[MCUMAX_HASH_BUCKET_SIZE];
+};
 
-    uint8_t step_depth;
-    int32_t step_alpha;
-    int32_t step_score;
-    int32_t step_score_new;
+#ifdef MCUMAX_HASH_FILES
+#define MCUMAX_HASH_FILE_MAGIC "mcu-max hash"
+#define MCUMAX_HASH_FILE_VERSION 2
 
-    // Adj. window: delay bonus
-    alpha -= alpha < score;
-    beta -= beta <= score;
+// Hash file header, one cache line
+struct HashFileHeader
+{
+    char magic[16];
+    uint32_t version;
+    uint32_t entry_size;
+    uint32_t bucket_size;
+    uint32_t bucket_num;
+    uint32_t key_scheme; // Scramble table checksum
+    uint8_t generation;
+    uint8_t reserved[27];
+};
+#endif
 
-#ifdef MCUMAX_HASHING_ENABLED
-    // Lookup pos. in hash table
-    struct HashEntry *hash_entry = mcumax_hash_table +
-                                   ((mcumax.hash_key +
-                                     mcumax.current_side * en_passant_square) &
-                                    MCUMAX_HASH_TABLE_SIZE - 1);
+static struct HashBucket mcumax_hash_storage[MCUMAX_HASH_BUCKET_NUM] MCUMAX_HASH_ALIGNED;
+static struct HashBucket *mcumax_hash_table = mcumax_hash_storage;
+static uint8_t mcumax_hash_generation;
 
-    iter_depth = hash_entry->depth;
-    iter_score = hash_entry->score;
-    iter_square_from = hash_entry->square_from;
-    iter_square_to = hash_entry->square_to;
+#ifdef MCUMAX_HASH_MMAP
+static void *mcumax_hash_map; // Mapped hash file
+static size_t mcumax_hash_map_size;
+#endif
 
-    // Resume at stored depth
-    if ((hash_entry->key2 != mcumax.hash_key2) ||
-        (mode != MCUMAX_INTERNAL_NODE) || // Miss: other pos. or empty
-        !(((iter_score <= alpha) ||
-           (iter_square_from & 0x8)) &&
-          ((iter_score >= beta) ||
-           (iter_square_from & MCUMAX_SQUARE_INVALID)))) // Or window incompatible
+// Returns the bucket of the current position with the given side and e.p. square
+static struct HashBucket *mcumax_hash_bucket(uint8_t side, uint8_t en_passant_square)
+{
+    return mcumax_hash_table +
+           ((mcumax.hash_key + side * en_passant_square) &
+            (MCUMAX_HASH_BUCKET_NUM - 1));
+}
+
+// Returns the entry with the given key, or NULL on a miss
+static struct HashEntry *mcumax_hash_probe(struct HashBucket *bucket, uint16_t key)
+{
+    for (uint32_t i = 0; i < MCUMAX_HASH_BUCKET_SIZE; i++)
     {
-        // Start iteration from scratch
-        iter_depth =
-            iter_square_to = 0;
+        struct HashEntry *entry = &bucket->entries[i];
+
+        if ((MCUMAX_HASH_ENTRY_KEY(entry) == key) && MCUMAX_HASH_ENTRY_DEPTH(entry))
+            return entry;
     }
 
-    // Start at best-move hint
-    iter_square_from &= ~MCUMAX_BOARD_MASK;
+    return NULL;
+}
 
-    hash_key = mcumax.hash_key;
-    hash_key2 = mcumax.hash_key2;
-#else
-    iter_depth =
-        iter_score =
-            iter_square_from =
-                iter_square_to = 0;
-#endif
+// Returns the entry with the given key, or else the entry to replace:
+// the shallowest one, aged by search generation
+static struct HashEntry *mcumax_hash_replace(struct HashBucket *bucket, uint16_t key)
+{
+    struct HashEntry *replace_entry = &bucket->entries[0];
+    int32_t replace_worth = INT32_MAX;
 
-    // Min depth = 2 iterative deepening loop
-    // root: deepen upto time
-    // time's up: go do best
-    while ((iter_depth++ < depth) ||
-           (iter_depth < 3) ||
-           ((mode != MCUMAX_INTERNAL_NODE) &&
-            (mcumax.square_from == MCUMAX_SQUARE_INVALID) &&
-            (((mcumax.node_count < mcumax.node_max) &&
-              (iter_depth <= mcumax.depth_max)) ||
-             (mcumax.square_from = iter_square_from,
-              mcumax.square_to = iter_square_to & ~MCUMAX_BOARD_MASK,
-              iter_depth = 3))))
+    for (uint32_t i = 0; i < MCUMAX_HASH_BUCKET_SIZE; i++)
     {
-        if (mcumax.stop_search)
-            break;
+        struct HashEntry *entry = &bucket->entries[i];
 
-        // Start scan at previous best
-        square_from =
-            square_start = (mode != MCUMAX_SEARCH_VALID_MOVES)
-                               ? iter_square_from
-                               : 0;
+        if ((MCUMAX_HASH_ENTRY_KEY(entry) == key) && MCUMAX_HASH_ENTRY_DEPTH(entry))
+            return entry;
 
-        // Request try noncastling first
-        replay_move = iter_square_to & MCUMAX_SQUARE_INVALID;
+        int32_t worth = MCUMAX_HASH_ENTRY_DEPTH(entry) -
+                        MCUMAX_HASH_AGE_WEIGHT *
+                            ((mcumax_hash_generation - MCUMAX_HASH_ENTRY_GENERATION(entry)) &
+                             MCUMAX_HASH_GENERATION_MASK);
+        if (worth < replace_worth)
+        {
+            replace_entry = entry;
+            replace_worth = worth;
+        }
+    }
 
-        // Change side
-        mcumax.current_side ^= 0x18;
+    return replace_entry;
+}
 
-        // Search null move
-        null_move_score = (iter_depth > 2) && (beta != -MCUMAX_SCORE_MAX)
-                              ? mcumax_search(-beta,
-                                              1 - beta,
-                                              -score,
-                                              MCUMAX_SQUARE_INVALID,
-                                              iter_depth - 3,
-                                              MCUMAX_INTERNAL_NODE)
-                              : MCUMAX_SCORE_MAX;
+// Reads an entry. Move: best-move squares, bound flags in square_from
+// (8: lower, MCUMAX_SQUARE_INVALID: upper), replay flag in square_to
+static void mcumax_hash_read(const struct HashEntry *entry,
+                             uint8_t *depth,
+                             mcumax_score *score,
+                             uint8_t *square_from,
+                             uint8_t *square_to)
+{
+#if defined(MCUMAX_HASH_COMPACT)
+    *depth = MCUMAX_HASH_ENTRY_DEPTH(entry);
+    *score = (entry->score_bound - (entry->score_bound & 0x3)) / 4;
+    *square_from = MCUMAX_HASH_SQUARE(entry->move & 0x3f) |
+                   ((entry->score_bound & 0x1) ? 8 : 0) |
+                   ((entry->score_bound & 0x2) ? MCUMAX_SQUARE_INVALID : 0);
+    *square_to = MCUMAX_HASH_SQUARE((entry->move >> 6) & 0x3f) |
+                 ((entry->move & 0x1000) ? MCUMAX_SQUARE_INVALID : 0);
+#else
+    *depth = entry->depth;
+    *score = entry->score;
+    *square_from = entry->square_from;
+    *square_to = entry->square_to;
+#endif
+}
 
-        // Change side
-        mcumax.current_side ^= 0x18;
+// Writes an entry of the current search generation
+static void mcumax_hash_write(struct HashEntry *entry,
+                              uint16_t key,
+                              uint8_t depth,
+                              mcumax_score score,
+                              uint8_t square_from,
+                              uint8_t square_to)
+{
+    if (depth > MCUMAX_HASH_DEPTH_MAX)
+        depth = MCUMAX_HASH_DEPTH_MAX;
+
+#if defined(MCUMAX_HASH_COMPACT)
+    entry->key_depth = (key << 4) | depth;
+    entry->score_bound = score * 4 +
+                         ((square_from & 8) ? 0x1 : 0) +
+                         ((square_from & MCUMAX_SQUARE_INVALID) ? 0x2 : 0);
+    entry->move = MCUMAX_SQUARE_INDEX(square_from & 0x77) |
+                  (MCUMAX_SQUARE_INDEX(square_to & 0x77) << 6) |
+                  ((square_to & MCUMAX_SQUARE_INVALID) ? 0x1000 : 0) |
+                  ((mcumax_hash_generation & MCUMAX_HASH_GENERATION_MASK) << 13);
+#else
+    entry->key = key;
+    entry->score = score;
+    entry->depth = depth;
+    entry->generation = mcumax_hash_generation;
+    entry->square_from = square_from;
+    entry->square_to = square_to;
+#endif
+}
 
-        // Prune if > beta unconsidered:static eval
-        iter_score = (-null_move_score < beta) ||
-                             (mcumax.non_pawn_material > 35)
-                         ? (iter_depth - 2)
-                               ? -MCUMAX_SCORE_MAX
-                               : score
-                         : -null_move_score;
+// Starts a search generation. Compact entries keep only 3 bits of it, so
+// entries one wrap old, which would look fresh, are dropped
+static void mcumax_hash_next_generation(void)
+{
+    mcumax_hash_generation++;
 
-        // Node count (for timing)
-        mcumax.node_count++;
+#if defined(MCUMAX_HASH_COMPACT)
+    uint8_t generation = mcumax_hash_generation & MCUMAX_HASH_GENERATION_MASK;
 
-        do
+    for (uint32_t i = 0; i < MCUMAX_HASH_BUCKET_NUM; i++)
+    {
+        for (uint32_t j = 0; j < MCUMAX_HASH_BUCKET_SIZE; j++)
         {
-            // Scan board looking for
-            scan_piece = mcumax.board[square_from];
-
-            // Own piece (inefficient!)
-            if (scan_piece & mcumax.current_side)
-            {
-                // p = piece type (set r>0)
-                step_vector = scan_piece_type = (scan_piece & 0b111);
+            struct HashEntry *entry = &mcumax_hash_table[i].entries[j];
 
-                // First step vector for piece
-                step_vector_index = mcumax_step_vectors_indices[scan_piece_type];
+            if (MCUMAX_HASH_ENTRY_GENERATION(entry) == generation)
+                entry->key_depth &= ~0xf;
+        }
+    }
+#endif
+}
 
-                // Loop over directions o[]
-                while ((step_vector = ((scan_piece_type > 2) &&
-                                       (step_vector < 0))
-                                          ? -step_vector
-                                          : -mcumax_step_vectors[++step_vector_index]))
-                {
-                replay:
-                    // Resume normal after best
-                    square_to = square_from;
+#endif
 
-                    castling_skip_square =
-                        castling_rook_square = MCUMAX_SQUARE_INVALID;
+typedef bool (*mcumax_move_callback)(mcumax_move move);
 
-                    // y traverses ray, or:
-                    do
-                    {
-                        // Sneak in previous best move
-                        capture_square =
-                            square_to =
-                                replay_move
-                                    ? (iter_square_to ^ replay_move)
-                                    : (square_to + step_vector);
+#ifdef MCUMAX_BITBOARDS
 
-                        // Board edge hit
-                        if (square_to & MCUMAX_BOARD_MASK)
-                            break;
+#define MCUMAX_BITBOARD_SQUARE(index) ((((index) & 0x38) << 1) | ((index) & 0x7))
+#define MCUMAX_BITBOARD_BIT(square) ((uint64_t)1 << MCUMAX_SQUARE_INDEX(square))
 
-                        // Bad castling
-                        if ((en_passant_square != MCUMAX_SQUARE_INVALID) &&
-                            mcumax.board[en_passant_square] &&
-                            ((square_to - en_passant_square) < 2) &&
-                            ((en_passant_square - square_to) < 2))
-                            iter_score = MCUMAX_SCORE_MAX;
+static uint8_t mcumax_bitboard_lowest(uint64_t bitboard)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(bitboard);
+#else
+    uint8_t index = 0;
+    while (!(bitboard & 1))
+    {
+        bitboard >>= 1;
+        index++;
+    }
 
-                        // Shift capture square if en-passant
-                        if ((scan_piece_type < 3) &&
-                            (square_to == en_passant_square))
-                            capture_square ^= 16;
+    return index;
+#endif
+}
 
-                        capture_piece = mcumax.board[capture_square];
+static uint8_t mcumax_bitboard_highest(uint64_t bitboard)
+{
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(bitboard);
+#else
+    uint8_t index = 63;
+    while (!(bitboard & ((uint64_t)1 << 63)))
+    {
+        bitboard <<= 1;
+        index--;
+    }
 
-                        // Capture own, bad pawn mode
-                        if ((capture_piece & mcumax.current_side) ||
-                            ((scan_piece_type < 3) &&
-                             !((square_to - square_from) & 0b111) - !capture_piece))
-                            break;
+    return index;
+#endif
+}
 
-                        // Value of captured piece
-                        capture_piece_value = 37 * mcumax_capture_values[capture_piece & 0b111] +
-                                              (capture_piece & 0xc0);
+// Ray directions of the masks (mcu-max-masks.h); nearest piece is the lowest
+// bit on rays with positive steps, the highest bit on the others
+static const int8_t mcumax_ray_steps[8] = {
+    1, 15, 16, 17, -1, -15, -16, -17};
 
-                        // King capture
-                        if (capture_piece_value < 0)
-                        {
-                            iter_score = MCUMAX_SCORE_MAX;
-                            iter_depth = MCUMAX_DEPTH_MAX - 1;
-                        }
+// Rebuilds bitboards from board: on SSE2 and NEON hosts, one compare per
+// rank and side
+static void mcumax_init_bitboards(void)
+{
+    mcumax.bitboards[0] =
+        mcumax.bitboards[1] = 0;
 
-                        // Abort on fail high
-                        if ((iter_score >= beta) &&
-                            (iter_depth > 1))
-                            goto cutoff;
+#if defined(__SSE2__)
+    const __m128i white = _mm_set1_epi8(MCUMAX_BOARD_WHITE);
+    const __m128i black = _mm_set1_epi8(MCUMAX_BOARD_BLACK);
 
-                        // MVV/LVA scoring if depth == 1
-                        step_score = (iter_depth != 1)
-                                         ? score
-                                         : capture_piece_value - scan_piece_type;
+    for (uint8_t row = 0; row < 8; row++)
+    {
+        __m128i rank = _mm_loadu_si128((const __m128i *)&mcumax.board[row << 4]);
 
-                        // All captures if depth == 2
-                        if ((iter_depth - !capture_piece) > 1)
-                        {
-                            // Center positional score
-                            step_score = (scan_piece_type < 6)
-                                             ? mcumax.board[square_from + 0x8] -
-                                                   mcumax.board[square_to + 0x8]
-                                             : 0;
+        mcumax.bitboards[0] |= (uint64_t)(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(rank, white), white)) & 0xff)
+                               << (row << 3);
+        mcumax.bitboards[1] |= (uint64_t)(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(rank, black), black)) & 0xff)
+                               << (row << 3);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    static const uint8_t bits[8] = {1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x8_t bit_weights = vld1_u8(bits);
 
-                            mcumax.board[castling_rook_square] =
-                                mcumax.board[capture_square] =
-                                    mcumax.board[square_from] = 0;
+    for (uint8_t row = 0; row < 8; row++)
+    {
+        uint8x8_t rank = vld1_u8(&mcumax.board[row << 4]);
 
-                            // Do move, set non-virgin
-                            mcumax.board[square_to] = scan_piece | MCUMAX_PIECE_MOVED;
+        mcumax.bitboards[0] |= (uint64_t)vaddv_u8(vand_u8(vtst_u8(rank, vdup_n_u8(MCUMAX_BOARD_WHITE)), bit_weights))
+                               << (row << 3);
+        mcumax.bitboards[1] |= (uint64_t)vaddv_u8(vand_u8(vtst_u8(rank, vdup_n_u8(MCUMAX_BOARD_BLACK)), bit_weights))
+                               << (row << 3);
+    }
+#else
+    for (uint8_t square = 0; square < 0x80; square++)
+    {
+        uint8_t piece = mcumax.board[square];
+        if (!(square & MCUMAX_BOARD_MASK) && piece)
+            mcumax.bitboards[(piece & MCUMAX_BOARD_BLACK) >> 4] |= MCUMAX_BITBOARD_BIT(square);
+    }
+#endif
+}
 
-                            // Castling: put rook & score
-                            if (!(castling_rook_square & MCUMAX_BOARD_MASK))
-                            {
-                                mcumax.board[castling_skip_square] = mcumax.current_side + 6;
-                                step_score += 50;
-                            }
+// Moves pieces in bitboards (self-inverse, used for both do and undo)
+static void mcumax_move_bitboards(uint8_t square_from,
+                                  uint8_t square_to,
+                                  uint8_t capture_square,
+                                  uint8_t capture_piece,
+                                  uint8_t castling_rook_square,
+                                  uint8_t castling_skip_square)
+{
+    uint64_t *own_pieces = &mcumax.bitboards[mcumax.current_side >> 4];
 
-                            // Freeze king in mid-game
-                            step_score -= ((scan_piece_type != 4) ||
-                                           (mcumax.non_pawn_material > 30))
-                                              ? 0
-                                              : 20;
+    *own_pieces ^= MCUMAX_BITBOARD_BIT(square_from) ^
+                   MCUMAX_BITBOARD_BIT(square_to);
 
-                            // Pawns
-                            if (scan_piece_type < 3)
-                            {
-                                step_score -=
-                                    9 * ((((square_from - 2) & MCUMAX_BOARD_MASK) ||
-                                          mcumax.board[square_from - 2] - scan_piece) +
-                                         // Structure, undefended
-                                         (((square_from + 2) & MCUMAX_BOARD_MASK) ||
-                                          mcumax.board[square_from + 2] - scan_piece) -
-                                         1 +
-                                         // Squares plus bias
-                                         (mcumax.board[square_from ^ 0x10] ==
-                                          (mcumax.current_side + 36))) // Cling to magnetic king
-                                    - (mcumax.non_pawn_material >> 2); // End-game Pawn-push bonus
-
-                                // Promotion / passer bonus
-                                capture_piece_value +=
-                                    step_alpha =
-                                        (square_to + step_vector + 1) & MCUMAX_SQUARE_INVALID
-                                            ? (647 - scan_piece_type)
-                                            : 2 * (scan_piece & (square_to + 0x10) & 0x20);
+    if (capture_piece)
+        mcumax.bitboards[(mcumax.current_side ^ 0x18) >> 4] ^=
+            MCUMAX_BITBOARD_BIT(capture_square);
 
-                                // Upgrade pawn or convert to queen
-                                mcumax.board[square_to] += step_alpha;
-                            }
+    // Castling rook
+    if (!(castling_rook_square & MCUMAX_BOARD_MASK))
+        *own_pieces ^= MCUMAX_BITBOARD_BIT(castling_rook_square) ^
+                       MCUMAX_BITBOARD_BIT(castling_skip_square);
+}
+
+// Next own piece after square_from, wrapping; square_start when none left
+static uint8_t mcumax_next_piece(uint8_t square_from, uint8_t square_start)
+{
+    uint64_t pieces = mcumax.bitboards[mcumax.current_side >> 4];
+    uint8_t index_from = MCUMAX_SQUARE_INDEX(square_from);
+    uint8_t index_start = MCUMAX_SQUARE_INDEX(square_start);
+
+    // Pieces above square_from
+    uint64_t above = (index_from < 63)
+                         ? pieces & ~(((uint64_t)2 << index_from) - 1)
+                         : 0;
+    // Pieces below square_start
+    uint64_t below = pieces & (((uint64_t)1 << index_start) - 1);
+
+    uint64_t candidates = (index_from < index_start)
+                              ? above & below
+                              : (above ? above : below);
+
+    return candidates
+               ? MCUMAX_BITBOARD_SQUARE(mcumax_bitboard_lowest(candidates))
+               : square_start;
+}
 
-#ifdef MCUMAX_HASHING_ENABLED
-                            mcumax.hash_key += Hash(0);
-                            mcumax.hash_key2 += Hash(8) + castling_rook_square - MCUMAX_SQUARE_INVALID;
 #endif
 
-                            // New score & alpha
-                            step_score += score + capture_piece_value;
-                            step_alpha = iter_score > alpha
-                                             ? iter_score
-                                             : alpha;
+// Adds piece to (add) or removes piece from (!add) evaluation
+static void mcumax_eval_piece(uint8_t piece, uint8_t square, bool add)
+{
+    uint8_t type = piece & 0b111;
+    if (!type)
+        return;
 
-                            // New depth, reduce non-capture
-                            step_depth = iter_depth - 1 -
-                                         ((iter_depth > 5) &&
-                                          (scan_piece_type > 2) &&
-                                          !capture_piece &&
-                                          !replay_move);
+    // Tables are from white's view
+    bool black = piece & MCUMAX_BOARD_BLACK;
+    uint8_t index = MCUMAX_PST_SQUARE(MCUMAX_SQUARE_INDEX(black ? (square ^ 0x70) : square));
 
-                            // Extend 1 ply if in check
-                            if (!((mcumax.non_pawn_material > 30) ||
-                                  (null_move_score - MCUMAX_SCORE_MAX) ||
-                                  (iter_depth < 3) ||
-                                  (capture_piece &&
-                                   (scan_piece_type != 4))))
-                                step_depth = iter_depth;
+    int16_t mg = mcumax_pst_mg[MCUMAX_PST_PIECE(type)][index];
+    int16_t eg = mcumax_pst_eg[MCUMAX_PST_PIECE(type)][index];
 
-                            // Futility, recursive evaluation of reply
-                            do
-                            {
-                                // Change side
-                                mcumax.current_side ^= 0x18;
+    if (add != black)
+    {
+        mcumax.eval_mg += mg;
+        mcumax.eval_eg += eg;
+    }
+    else
+    {
+        mcumax.eval_mg -= mg;
+        mcumax.eval_eg -= eg;
+    }
 
-                                step_score_new = ((mode == MCUMAX_SEARCH_VALID_MOVES) ||
-                                                  (step_depth > 2) ||
-                                                  (step_score > step_alpha))
-                                                     ? -mcumax_search(-beta,
-                                                                      -step_alpha,
-                                                                      -step_score,
-                                                                      castling_skip_square,
-                                                                      step_depth,
-                                                                      MCUMAX_INTERNAL_NODE)
-                                                     : step_score;
+    uint16_t side_phase = mcumax_phase_weights[type] << (black ? 8 : 0);
 
-                                // Change side
-                                mcumax.current_side ^= 0x18;
-                            } while ((step_score_new > alpha) &&
-                                     (++step_depth < iter_depth));
+    if (add)
+    {
+        mcumax.phase += mcumax_phase_weights[type];
+        mcumax.side_phases += side_phase;
+    }
+    else
+    {
+        mcumax.phase -= mcumax_phase_weights[type];
+        mcumax.side_phases -= side_phase;
+    }
+}
 
-                            // No fail: re-search unreduced
-                            step_score = step_score_new;
+// Pawn structure and king shelter terms of a board, per side (white, black)
+struct mcumax_pawn_features
+{
+    uint8_t doubled[2];
+    uint8_t isolated[2];
+    uint8_t passed[2][8];  // By row, white's view
+    uint8_t shelter[2][3]; // By shield pawn distance (none, one, two rows)
+};
 
-                            if ((mode == MCUMAX_PLAY_MOVE) &&
-                                (step_score != -MCUMAX_SCORE_MAX) &&
-                                (square_from == mcumax.square_from) &&
-                                (square_to == mcumax.square_to))
-                            {
-                                // Playing move
-                                mcumax.score = -score - capture_piece_value;
-                                mcumax.en_passant_square = castling_skip_square;
+static void mcumax_get_pawn_features(const uint8_t *board, struct mcumax_pawn_features *features)
+{
+    // Per side and file: pawns, smallest and largest row
+    uint8_t pawns[2][8];
+    uint8_t rows_min[2][8];
+    uint8_t rows_max[2][8];
+    uint8_t king_squares[2] = {MCUMAX_SQUARE_INVALID, MCUMAX_SQUARE_INVALID};
 
-#ifdef MCUMAX_HASHING_ENABLED
-                                // Lock game in hash as draw
-                                hash_entry->depth = MCUMAX_DEPTH_MAX;
-                                hash_entry->score = 0;
-#endif
+    memset(pawns, 0, sizeof(pawns));
+    memset(rows_min, 8, sizeof(rows_min));
+    memset(rows_max, 0, sizeof(rows_max));
 
-                                // Total captured material
-                                mcumax.non_pawn_material += capture_piece_value >> 7;
+    for (uint8_t square = 0; square < 0x80; square++)
+    {
+        uint8_t piece = board[square];
+        uint8_t side = (piece & MCUMAX_BOARD_BLACK) >> 4;
+        uint8_t row = square >> 4;
+        uint8_t file = square & 0x7;
 
-                                // Change side
-                                mcumax.current_side ^= 0x18;
+        if ((square & MCUMAX_BOARD_MASK) || !(piece & 0b111))
+            continue;
 
-                                // Captured non-pawn material
-                                return beta;
-                            }
+        if ((piece & 0b111) == MCUMAX_KING)
+            king_squares[side] = square;
+        else if ((piece & 0b111) < 3)
+        {
+            pawns[side][file]++;
+            if (row < rows_min[side][file])
+                rows_min[side][file] = row;
+            if (row > rows_max[side][file])
+                rows_max[side][file] = row;
+        }
+    }
 
-#ifdef MCUMAX_HASHING_ENABLED
-                            mcumax.hash_key = hash_key;
-                            mcumax.hash_key2 = hash_key2;
-#endif
+    memset(features, 0, sizeof(*features));
 
-                            // Undo move
-                            mcumax.board[castling_rook_square] = mcumax.current_side + 6;
-                            mcumax.board[castling_skip_square] = mcumax.board[square_to] = 0;
-                            mcumax.board[square_from] = scan_piece;
-                            mcumax.board[capture_square] = capture_piece;
+    for (uint8_t square = 0; square < 0x80; square++)
+    {
+        uint8_t piece = board[square];
+        uint8_t side = (piece & MCUMAX_BOARD_BLACK) >> 4;
+        uint8_t row = square >> 4;
+        uint8_t file = square & 0x7;
 
-                            if ((mode == MCUMAX_SEARCH_BEST_MOVE) &&
-                                (step_score != -MCUMAX_SCORE_MAX) &&
-                                (square_from == mcumax.square_from) &&
-                                (square_to == mcumax.square_to))
-                                // Searching best move
-                                return beta;
+        if ((square & MCUMAX_BOARD_MASK) || !(piece & 0b111) || ((piece & 0b111) > 2))
+            continue;
 
-                            if ((mode == MCUMAX_SEARCH_VALID_MOVES) &&
-                                (step_score != -MCUMAX_SCORE_MAX) &&
-                                (mcumax.square_from == MCUMAX_SQUARE_INVALID) &&
-                                (iter_depth == 3) &&
-                                !replay_move)
-                            {
-                                // Searching valid moves
-                                mcumax_move move = {square_from, square_to};
+        bool isolated = true;
+        // Front pawn of its file
+        bool passed = side ? (row == rows_max[1][file]) : (row == rows_min[0][file]);
 
-                                if (mcumax.valid_moves_num < mcumax.valid_moves_buffer_size)
-                                    mcumax.valid_moves_buffer[mcumax.valid_moves_num] = move;
+        for (int8_t neighbour = file - 1; neighbour <= file + 1; neighbour++)
+        {
+            if ((neighbour < 0) || (neighbour > 7))
+                continue;
 
-                                mcumax.valid_moves_num++;
-                            }
-                        }
+            if ((neighbour != file) && pawns[side][neighbour])
+                isolated = false;
 
-                        // New best, update max,best
-                        if (step_score > iter_score)
-                        {
-                            // Mark non-double
-                            iter_score = step_score;
-                            iter_square_from = square_from;
-                            iter_square_to = square_to |
-                                             (castling_skip_square & MCUMAX_SQUARE_INVALID);
-                        }
+            // No opposing pawn ahead (white moves to row 0)
+            if (side ? (rows_max[0][neighbour] > row) : (rows_min[1][neighbour] < row))
+                passed = false;
+        }
 
-                        if (replay_move)
-                        {
-                            // Redo after doing old best
-                            replay_move = 0;
+        features->doubled[side] += (rows_min[side][file] != rows_max[side][file]);
+        features->isolated[side] += isolated;
+        features->passed[side][side ? (7 - row) : row] += passed;
+    }
 
-                            goto replay;
-                        }
+    // King shelter: own pawns up to two rows ahead on the king's and adjacent files,
+    // for kings on their home ranks
+    for (uint8_t side = 0; side < 2; side++)
+    {
+        uint8_t king_square = king_squares[side];
+        int8_t forward = side ? 0x10 : -0x10;
 
-                        // Not first step, moved before
-                        if ((square_from + step_vector - square_to) ||
-                            (scan_piece & MCUMAX_PIECE_MOVED) ||
-                            // No pawn and no lateral king move
-                            ((scan_piece_type > 2) &&
-                             (((scan_piece_type != 4) ||
-                               (step_vector_index != 7) ||
-                               // No virgin rook in corner
-                               (mcumax.board[castling_rook_square =
-                                                 ((square_from + 3) ^
-                                                  ((step_vector >> 1) & 0b111))] -
-                                mcumax.current_side - 6) ||
-                               // No two empty squares next to rook
-                               mcumax.board[castling_rook_square ^ 1] ||
-                               mcumax.board[castling_rook_square ^ 2]))))
-                            // Fake capture for nonsliding
-                            capture_piece += (scan_piece_type < 5);
-                        else
-                            // Enable en-passant
-                            castling_skip_square = square_to;
+        if ((king_square == MCUMAX_SQUARE_INVALID) ||
+            ((side ? (king_square >> 4) : (7 - (king_square >> 4))) > 1))
+            continue;
 
-                        // If no capture, continue ray
-                    } while (!capture_piece);
+        for (int8_t step = -1; step <= 1; step++)
+        {
+            uint8_t shelter = 0;
+
+            for (uint8_t distance = 1; distance <= 2; distance++)
+            {
+                uint8_t square = king_square + step + distance * forward;
+                uint8_t piece = board[square & 0x7f];
+
+                if (!(square & MCUMAX_BOARD_MASK) &&
+                    (piece & 0b111) &&
+                    ((piece & 0b111) < 3) &&
+                    (((piece & MCUMAX_BOARD_BLACK) >> 4) == side))
+                {
+                    shelter = distance;
+
+                    break;
                 }
             }
 
-            // Next square of board, wrap
-        } while ((square_from = ((square_from + 9) &
-                                 ~MCUMAX_BOARD_MASK)) != square_start);
+            if (!((king_square + step) & MCUMAX_BOARD_MASK))
+                features->shelter[side][shelter]++;
+        }
+    }
+}
 
-    cutoff:
-        // Check test thru NM best loses king: (stale)mate
-        if ((iter_score == -MCUMAX_SCORE_MAX) &&
-            (null_move_score != MCUMAX_SCORE_MAX))
-            iter_score = 0;
+// Pawn structure (doubled, isolated, passed pawns) and king shelter, white's view
+static void mcumax_eval_pawn_structure(int16_t *mg, int16_t *eg)
+{
+    struct mcumax_pawn_features features;
+    mcumax_get_pawn_features(mcumax.board, &features);
 
-#ifdef MCUMAX_HASHING_ENABLED
-        // Protect game history
-        if (hash_entry->depth < MCUMAX_DEPTH_MAX)
-        {
-            hash_entry->key2 = mcumax.hash_key2;
-            hash_entry->score = iter_score;
-            hash_entry->depth = iter_depth;
+    int32_t score_mg[2] = {0, 0};
+    int32_t score_eg[2] = {0, 0};
+
+    for (uint8_t side = 0; side < 2; side++)
+    {
+        score_mg[side] = features.doubled[side] * MCUMAX_PAWN_DOUBLED_MG +
+                         features.isolated[side] * MCUMAX_PAWN_ISOLATED_MG;
+        score_eg[side] = features.doubled[side] * MCUMAX_PAWN_DOUBLED_EG +
+                         features.isolated[side] * MCUMAX_PAWN_ISOLATED_EG;
 
-            // Move, type (bound/exact)
-            hash_entry->square_from = iter_square_from |
-                                      8 * (iter_score > alpha) |
-                                      MCUMAX_SQUARE_INVALID * (iter_score < beta);
-            hash_entry->square_to = iter_square_to;
+        for (uint8_t row = 0; row < 8; row++)
+        {
+            score_mg[side] += features.passed[side][row] * mcumax_pawn_passed_mg[row];
+            score_eg[side] += features.passed[side][row] * mcumax_pawn_passed_eg[row];
         }
-#endif
 
-        // Kibitz
-        // if (in_root)
-        //     printf("%2d %6d %10d %c%c%c%c\n",
-        //         iter_depth - 2,
-        //         iter_score,
-        //         mcumax.node_count,
-        //         'a' + (iter_square_from & 0b111),
-        //         '8' - (iter_square_from >> 4),
-        //         'a' + (iter_square_to & 0b111),
-        //         '8' - (iter_square_to >> 4 & 0b111));
+        for (uint8_t shelter = 0; shelter < 3; shelter++)
+            score_mg[side] += features.shelter[side][shelter] * mcumax_king_shelter_mg[shelter];
     }
 
-    // Delayed-loss bonus
-    return iter_score += iter_score < score;
+    *mg = score_mg[0] - score_mg[1];
+    *eg = score_eg[0] - score_eg[1];
 }
 
-/***************************************************************************/
-
-void mcumax_init()
+#if MCUMAX_PAWN_HASH_SIZE
+// Pawn hash: pawn structure by key of pawns and kings
+struct PawnHashEntry
 {
-    for (uint32_t x = 0; x < 8; x++)
-    {
-        // Setup pieces (left side)
-        mcumax.board[0x10 * 0 + x] = MCUMAX_BOARD_BLACK | mcumax_board_setup[x];
-        mcumax.board[0x10 * 1 + x] = MCUMAX_BOARD_BLACK | MCUMAX_PAWN_DOWNSTREAM;
-        for (uint32_t y = 2; y < 6; y++)
-            mcumax.board[0x10 * y + x] = MCUMAX_EMPTY;
-        mcumax.board[0x10 * 6 + x] = MCUMAX_BOARD_WHITE | MCUMAX_PAWN_UPSTREAM;
-        mcumax.board[0x10 * 7 + x] = MCUMAX_BOARD_WHITE | mcumax_board_setup[x];
+    uint32_t key;
+    int16_t mg;
+    int16_t eg;
+};
 
-        // Setup weights (right side)
-        for (uint32_t y = 0; y < 8; y++)
-            mcumax.board[16 * y + x + 8] = (x - 4) * (x - 4) + (y - 4) * (y - 3);
-    }
-    mcumax.current_side = MCUMAX_BOARD_WHITE;
+static struct PawnHashEntry mcumax_pawn_hash_table[MCUMAX_PAWN_HASH_SIZE];
+#endif
 
-    mcumax.score = 0;
-    mcumax.en_passant_square = MCUMAX_SQUARE_INVALID;
-    mcumax.non_pawn_material = 0;
+// Returns the pawn key scramble value of pawns and kings
+static uint32_t mcumax_pawn_scramble(uint8_t square, uint8_t piece)
+{
+    uint8_t type = piece & 0b111;
 
-#ifdef MCUMAX_HASHING_ENABLED
-    mcumax.hash_key = 0;
-    mcumax.hash_key2 = 0;
+    return (type && ((type < 3) || (type == MCUMAX_KING)))
+               ? HashScramble(square + 4, piece)
+               : 0;
+}
 
-    memset(mcumax_hash_table, 0, sizeof(mcumax_hash_table));
+// Updates pawn structure evaluation, from pawn hash if enabled
+static void mcumax_eval_pawns(void)
+{
+#if MCUMAX_PAWN_HASH_SIZE
+    struct PawnHashEntry *entry = &mcumax_pawn_hash_table[mcumax.pawn_key & (MCUMAX_PAWN_HASH_SIZE - 1)];
 
-    // for (uint32_t i = MCUMAX_HASH_SCRAMBLE_TABLE_SIZE - 1; i > MCUMAX_BOARD_MASK; i--)
-    //     mcumax_scramble_table[i] = rand() & 0xff;
+    if (entry->key != mcumax.pawn_key)
+    {
+        entry->key = mcumax.pawn_key;
+        mcumax_eval_pawn_structure(&entry->mg, &entry->eg);
+    }
 
-    srand(1);
-    for (uint32_t i = 0; i < 1035; i++)
-        mcumax_scramble_table[i] =
-            ((rand() & 0xff) << 0) |
-            ((rand() & 0xff) << 8) |
-            ((rand() & 0xff) << 16) |
-            ((rand() & 0xff) << 24);
+    mcumax.pawn_mg = entry->mg;
+    mcumax.pawn_eg = entry->eg;
+#else
+    mcumax_eval_pawn_structure(&mcumax.pawn_mg, &mcumax.pawn_eg);
 #endif
 }
 
-static mcumax_square mcumax_set_piece(mcumax_square square, mcumax_piece piece)
+// Tapered evaluation for the side to move
+static int32_t mcumax_eval_blend(int32_t eval_mg, int32_t eval_eg, uint8_t phase)
 {
-    if (square & MCUMAX_BOARD_MASK)
-        return square;
+    if (phase > MCUMAX_PHASE_MAX)
+        phase = MCUMAX_PHASE_MAX;
 
-    mcumax.board[square] = piece ? (piece | MCUMAX_PIECE_MOVED) : piece;
+    int32_t eval = ((int32_t)eval_mg * phase +
+                    (int32_t)eval_eg * (MCUMAX_PHASE_MAX - phase)) /
+                   MCUMAX_PHASE_MAX;
 
-    return square + 1;
+    return (mcumax.current_side == MCUMAX_BOARD_WHITE) ? eval : -eval;
 }
 
-mcumax_piece mcumax_get_piece(mcumax_square square)
+// Saturates a static score below the mate scores, in both integer profiles
+static mcumax_score mcumax_saturate_score(int32_t score)
+{
+    if (score > MCUMAX_SCORE_STATIC_MAX)
+        return MCUMAX_SCORE_STATIC_MAX;
+    if (score < -MCUMAX_SCORE_STATIC_MAX)
+        return -MCUMAX_SCORE_STATIC_MAX;
+
+    return score;
+}
+
+// Rebuilds evaluation, pawn structure and score (side to move's view) from
+// board, so draws score 0 in set-up positions too
+static void mcumax_init_eval(void)
+{
+    int32_t material = 0;
+
+    mcumax.eval_mg =
+        mcumax.eval_eg = 0;
+    mcumax.phase = 0;
+    mcumax.side_phases = 0;
+
+    for (uint8_t square = 0; square < 0x80; square++)
+    {
+        uint8_t piece = mcumax.board[square];
+
+        if (!(square & MCUMAX_BOARD_MASK))
+        {
+            mcumax_eval_piece(piece, square, true);
+
+            if ((piece & 0b111) && ((piece & 0b111) != MCUMAX_KING))
+                material += (piece & mcumax.current_side)
+                                ? mcumax_piece_values[piece & 0b111]
+                                : -mcumax_piece_values[piece & 0b111];
+        }
+    }
+
+    mcumax_eval_pawn_structure(&mcumax.pawn_mg, &mcumax.pawn_eg);
+
+    mcumax.score = mcumax_saturate_score(material +
+                                         mcumax_eval_blend(mcumax.eval_mg + mcumax.pawn_mg,
+                                                           mcumax.eval_eg + mcumax.pawn_eg,
+                                                           mcumax.phase));
+}
+
+// Rebuilds king squares from board
+static void mcumax_init_king_squares(void)
+{
+    mcumax.king_squares[0] =
+        mcumax.king_squares[1] = MCUMAX_SQUARE_INVALID;
+
+    for (uint8_t square = 0; square < 0x80; square++)
+    {
+        uint8_t piece = mcumax.board[square];
+        if (!(square & MCUMAX_BOARD_MASK) && ((piece & 0b111) == MCUMAX_KING))
+            mcumax.king_squares[(piece & MCUMAX_BOARD_BLACK) >> 4] = square;
+    }
+}
+
+// Rebuilds hash keys from board, as the sum of the pieces' scramble values
+static void mcumax_init_hash_keys(void)
+{
+#ifdef MCUMAX_HASHING_ENABLED
+    mcumax.hash_key = 0;
+#endif
+    mcumax.hash_key2 = 0;
+    mcumax.pawn_key = 0;
+
+    for (uint8_t square = 0; square < 0x80; square++)
+    {
+        uint8_t piece = mcumax.board[square];
+        if (!(square & MCUMAX_BOARD_MASK) && piece)
+        {
+#ifdef MCUMAX_HASHING_ENABLED
+            mcumax.hash_key += HashScramble(square + 0, piece);
+#endif
+            mcumax.hash_key2 += HashScramble(square + 8, piece);
+            mcumax.pawn_key += mcumax_pawn_scramble(square, piece);
+        }
+    }
+}
+
+// Returns whether the current position is a draw by the fifty-move rule, or
+// repeats a position of the game or search (same side to move)
+static bool mcumax_is_draw(uint8_t ply, uint16_t halfmove_clock)
+{
+    if (halfmove_clock >= MCUMAX_HALFMOVE_DRAW)
+        return true;
+
+    uint32_t index = mcumax.history_num + ply;
+    uint32_t key = mcumax.history_keys[index];
+
+    for (uint32_t i = 4; (i <= halfmove_clock) && (i <= index); i += 2)
+        if (mcumax.history_keys[index - i] == key)
+            return true;
+
+    return false;
+}
+
+#if defined(MCUMAX_HASHING_ENABLED) && defined(MCUMAX_HASH_FILES)
+// Fills a hash file header for this build
+static void mcumax_hash_file_header(struct HashFileHeader *header)
+{
+    memset(header, 0, sizeof(*header));
+    strcpy(header->magic, MCUMAX_HASH_FILE_MAGIC);
+    header->version = MCUMAX_HASH_FILE_VERSION;
+    header->entry_size = sizeof(struct HashEntry);
+    header->bucket_size = MCUMAX_HASH_BUCKET_SIZE;
+    header->bucket_num = MCUMAX_HASH_BUCKET_NUM;
+
+    // FNV-1a
+    header->key_scheme = 0x811c9dc5;
+    for (uint32_t i = 0; i < MCUMAX_HASH_SCRAMBLE_TABLE_SIZE; i++)
+        header->key_scheme = (header->key_scheme ^ mcumax_scramble_table[i]) * 0x01000193;
+
+    header->generation = mcumax_hash_generation;
+}
+#endif
+
+// Returns true if square is attacked by side
+static bool mcumax_is_square_attacked(uint8_t square, uint8_t side)
 {
     if (square & MCUMAX_BOARD_MASK)
-        return MCUMAX_EMPTY;
+        return false;
+
+#ifdef MCUMAX_BITBOARDS
+    // Nearest piece on each ray (sliders, kings, pawns), then knight jumps
+    uint8_t index = MCUMAX_SQUARE_INDEX(square);
+    uint64_t occupied = mcumax.bitboards[0] | mcumax.bitboards[1];
+    uint64_t attackers = mcumax.bitboards[side >> 4];
+
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        uint64_t blockers = mcumax_ray_masks[index][i] & occupied;
+        if (!blockers)
+            continue;
+
+        uint8_t blocker_index = (i < 4)
+                                    ? mcumax_bitboard_lowest(blockers)
+                                    : mcumax_bitboard_highest(blockers);
+        if (!(attackers & ((uint64_t)1 << blocker_index)))
+            continue;
+
+        uint8_t attacker_square = MCUMAX_BITBOARD_SQUARE(blocker_index);
+
+        if (mcumax_attack_types[MCUMAX_ATTACK_INDEX(attacker_square, square)] &
+            mcumax_attack_piece_flags[mcumax.board[attacker_square] & 0b111])
+            return true;
+    }
+
+    for (uint64_t knights = mcumax_knight_masks[index] & attackers;
+         knights;
+         knights &= knights - 1)
+    {
+        if ((mcumax.board[MCUMAX_BITBOARD_SQUARE(mcumax_bitboard_lowest(knights))] & 0b111) ==
+            MCUMAX_KNIGHT)
+            return true;
+    }
+#else
+    // King/queen rays (sliders, kings, pawns), then knight jumps
+    for (uint8_t i = 7; i < 16; i++)
+    {
+        int8_t step = mcumax_step_vectors[i];
+
+        for (uint8_t j = 0; step && (j < 2); j++, step = -step)
+        {
+            uint8_t attacker_square = square;
+
+            do
+                attacker_square += step;
+            while (!(attacker_square & MCUMAX_BOARD_MASK) &&
+                   !mcumax.board[attacker_square] &&
+                   (i < 12));
+
+            if (attacker_square & MCUMAX_BOARD_MASK)
+                continue;
+
+            uint8_t piece = mcumax.board[attacker_square];
+
+            if ((piece & side) &&
+                (mcumax_attack_types[MCUMAX_ATTACK_INDEX(attacker_square, square)] &
+                 mcumax_attack_piece_flags[piece & 0b111]))
+                return true;
+        }
+    }
+#endif
+
+    return false;
+}
+
+// Returns true if square is attacked by a side's slider on the line through square_through
+static bool mcumax_is_line_attacked(uint8_t square, uint8_t square_through, uint8_t side)
+{
+    if (square & MCUMAX_BOARD_MASK)
+        return false;
+
+    uint8_t index = MCUMAX_ATTACK_INDEX(square, square_through);
+    if (!(mcumax_attack_types[index] &
+          (MCUMAX_ATTACK_DIAGONAL | MCUMAX_ATTACK_ORTHOGONAL)))
+        return false;
+
+    int8_t step = mcumax_attack_steps[index];
+
+#ifdef MCUMAX_BITBOARDS
+    uint8_t ray = 0;
+    while (mcumax_ray_steps[ray] != step)
+        ray++;
+
+    uint64_t blockers = mcumax_ray_masks[MCUMAX_SQUARE_INDEX(square)][ray] &
+                        (mcumax.bitboards[0] | mcumax.bitboards[1]);
+    if (!blockers)
+        return false;
+
+    uint8_t attacker_square = MCUMAX_BITBOARD_SQUARE((ray < 4)
+                                                         ? mcumax_bitboard_lowest(blockers)
+                                                         : mcumax_bitboard_highest(blockers));
+#else
+    uint8_t attacker_square = square;
+
+    do
+        attacker_square += step;
+    while (!(attacker_square & MCUMAX_BOARD_MASK) &&
+           !mcumax.board[attacker_square]);
+
+    if (attacker_square & MCUMAX_BOARD_MASK)
+        return false;
+#endif
+
+    uint8_t piece = mcumax.board[attacker_square];
+
+    return (piece & side) &&
+           (mcumax_attack_types[MCUMAX_ATTACK_INDEX(attacker_square, square)] &
+            mcumax_attack_piece_flags[piece & 0b111]);
+}
+
+// Returns true if the move just made leaves the mover's king attacked
+static bool mcumax_is_move_illegal(uint8_t square_from,
+                                   uint8_t square_to,
+                                   uint8_t capture_square,
+                                   uint8_t castling_rook_square,
+                                   uint8_t castling_skip_square,
+                                   bool in_check)
+{
+    uint8_t side = mcumax.current_side ^ 0x18;
+    uint8_t king_square = mcumax.king_squares[mcumax.current_side >> 4];
+
+    // Castling out of or through check
+    if (!(castling_rook_square & MCUMAX_BOARD_MASK) &&
+        (in_check ||
+         mcumax_is_square_attacked(castling_skip_square, side)))
+        return true;
+
+    // King moves, check evasions and en-passant need a full test
+    if ((king_square == square_to) ||
+        in_check ||
+        (capture_square != square_to))
+        return mcumax_is_square_attacked(king_square, side);
+
+    // Otherwise only a discovered attack is possible
+    return mcumax_is_line_attacked(king_square, square_from, side);
+}
+
+// Search node variables, saved to the node stack while a child is searched
+#define MCUMAX_NODE_VARIABLES(X) \
+    X(alpha)                     \
+    X(beta)                      \
+    X(score)                     \
+    X(en_passant_square)         \
+    X(depth)                     \
+    X(mode)                      \
+    X(iter_depth)                \
+    X(iter_score)                \
+    X(iter_square_from)          \
+    X(iter_square_to)            \
+    X(hash_key2)                 \
+    X(halfmove_clock)            \
+    X(eval_mg)                   \
+    X(eval_eg)                   \
+    X(phase)                     \
+    X(side_phases)               \
+    X(pawn_mg)                   \
+    X(pawn_eg)                   \
+    X(pawn_key)                  \
+    X(in_check)                  \
+    X(square_start)              \
+    X(square_from)               \
+    X(square_to)                 \
+    X(replay_move)               \
+    X(null_move_score)           \
+    X(scan_piece)                \
+    X(scan_piece_type)           \
+    X(step_vector)               \
+    X(step_vector_index)         \
+    X(castling_skip_square)      \
+    X(castling_rook_square)      \
+    X(capture_square)            \
+    X(capture_piece)             \
+    X(capture_piece_value)       \
+    X(step_depth)                \
+    X(step_alpha)                \
+    X(step_beta)                 \
+    X(step_score)                \
+    X(move_index)
+
+#ifdef MCUMAX_HASHING_ENABLED
+#define MCUMAX_NODE_HASH_VARIABLES(X) \
+    X(hash_key)                       \
+    X(hash_bucket)
+#else
+#define MCUMAX_NODE_HASH_VARIABLES(X)
+#endif
+
+#define MCUMAX_NODE_SAVE(name) node->name = name;
+#define MCUMAX_NODE_LOAD(name) name = node->name;
+
+// Returns the depth of the null move search
+static uint8_t mcumax_null_move_depth(uint8_t iter_depth, mcumax_score score, mcumax_score beta)
+{
+    int32_t margin_reduction = (score - beta) / MCUMAX_NULL_MOVE_MARGIN;
+    int32_t depth = iter_depth - 1 -
+                    (MCUMAX_NULL_MOVE_BASE +
+                     iter_depth / MCUMAX_NULL_MOVE_DIVISOR +
+                     ((margin_reduction < 2) ? margin_reduction : 2));
+
+    return (depth > 0) ? depth : 0;
+}
+
+// Returns ln(value) in 1/256, from log2 with linear mantissa
+static uint32_t mcumax_ln(uint32_t value)
+{
+    uint32_t exponent = 0;
+    while ((value >> exponent) > 1)
+        exponent++;
+
+    uint32_t mantissa = ((value << 8) >> exponent) - 256;
+
+    return ((exponent << 8) + mantissa) * 177 / 256;
+}
+
+// Returns the late move reduction by full-width depth and move index,
+// both capped; computed, not tabled, to keep it out of RAM
+static uint8_t mcumax_get_reduction(uint32_t depth, uint32_t moves)
+{
+    if (depth >= MCUMAX_LMR_DEPTH_NUM)
+        depth = MCUMAX_LMR_DEPTH_NUM - 1;
+    if (moves >= MCUMAX_LMR_MOVES_NUM)
+        moves = MCUMAX_LMR_MOVES_NUM - 1;
+
+    if ((depth < MCUMAX_LMR_DEPTH_MIN) ||
+        (moves < MCUMAX_LMR_MOVES_MIN))
+        return 0;
+
+    uint32_t product = mcumax_ln(depth) * mcumax_ln(moves);
+    int32_t reduction = (MCUMAX_LMR_BASE +
+                         (((product * 100 / MCUMAX_LMR_DIVISOR) * 100) >> 16)) /
+                        100;
+
+    // Keep a captures search
+    if (reduction > (int32_t)depth - 1)
+        reduction = depth - 1;
+    if (reduction < 0)
+        reduction = 0;
+
+    return reduction;
+}
+
+// Adds a MultiPV line found at this depth, ahead of the previous depth's lines,
+// so that a search stopped within a depth returns a full set. This depth's
+// lines stay sorted by score, in order found on ties; returns the line index
+static uint32_t mcumax_add_multipv_line(mcumax_scored_move line)
+{
+    mcumax_scored_move *lines = mcumax.multipv_buffer;
+    uint32_t index = 0;
+
+    while ((index < mcumax.multipv_pass) &&
+           (lines[index].score >= line.score))
+        index++;
+
+    // Drop the move's previous line, or else the last line if full
+    uint32_t drop_index = index;
+    while ((drop_index < mcumax.multipv_num) &&
+           ((lines[drop_index].move.from != line.move.from) ||
+            (lines[drop_index].move.to != line.move.to)))
+        drop_index++;
+
+    if (drop_index == mcumax.multipv_num)
+    {
+        if (mcumax.multipv_num < mcumax.multipv_buffer_size)
+            mcumax.multipv_num++;
+        else
+            drop_index--;
+    }
+
+    memmove(&lines[index + 1], &lines[index], (drop_index - index) * sizeof(mcumax_scored_move));
+    lines[index] = line;
+
+    mcumax.multipv_pass++;
+
+    return index;
+}
+
+#ifdef MCUMAX_ROOT_MOVES
+// Starts scanning the root move list, returns first square
+static uint8_t mcumax_begin_root_moves(void)
+{
+    mcumax.root_move_index = 0;
+    mcumax.root_move_node_mark = mcumax.node_count;
+
+    return mcumax.root_moves[0].from;
+}
+
+// Accounts the current root move's nodes, returns next square (MCUMAX_SQUARE_INVALID at end)
+static uint8_t mcumax_next_root_move(void)
+{
+    mcumax.root_move_node_counts[mcumax.root_move_index] +=
+        mcumax.node_count - mcumax.root_move_node_mark;
+    mcumax.root_move_node_mark = mcumax.node_count;
+
+    if (++mcumax.root_move_index >= mcumax.root_moves_num)
+        return MCUMAX_SQUARE_INVALID;
+
+    return mcumax.root_moves[mcumax.root_move_index].from;
+}
+
+// Orders the root move list: best move first, then by subtree node count
+static void mcumax_sort_root_moves(uint8_t best_square_from, uint8_t best_square_to)
+{
+    for (uint32_t i = 0; i < mcumax.root_moves_num; i++)
+    {
+        mcumax_move move = mcumax.root_moves[i];
+        int16_t score = mcumax.root_move_scores[i];
+        uint32_t node_count = ((move.from == best_square_from) &&
+                               (move.to == best_square_to))
+                                  ? UINT32_MAX
+                                  : mcumax.root_move_node_counts[i];
+
+        uint32_t j = i;
+        for (; j && (mcumax.root_move_node_counts[j - 1] < node_count); j--)
+        {
+            mcumax.root_moves[j] = mcumax.root_moves[j - 1];
+            mcumax.root_move_scores[j] = mcumax.root_move_scores[j - 1];
+            mcumax.root_move_node_counts[j] = mcumax.root_move_node_counts[j - 1];
+        }
+
+        mcumax.root_moves[j] = move;
+        mcumax.root_move_scores[j] = score;
+        mcumax.root_move_node_counts[j] = node_count;
+    }
+
+    memset(mcumax.root_move_node_counts, 0, sizeof(mcumax.root_move_node_counts));
+}
+
+// Fills the root score buffer from the root move scores, best first
+static void mcumax_set_root_scores(uint8_t depth)
+{
+    mcumax_scored_move *lines = mcumax.root_scores_buffer;
+
+    mcumax.root_scores_num = 0;
+
+    for (uint32_t i = 0; i < mcumax.root_moves_num; i++)
+    {
+        int32_t score = mcumax.root_move_scores[i];
+
+        // Illegal
+        if (score == -MCUMAX_SCORE_MAX)
+            continue;
+
+        uint32_t j = mcumax.root_scores_num;
+
+        if (j < mcumax.root_scores_buffer_size)
+            mcumax.root_scores_num++;
+        else
+        {
+            // Full: replace last move if better
+            if (score <= lines[j - 1].score)
+                continue;
+
+            j--;
+        }
+
+        for (; j && (lines[j - 1].score < score); j--)
+            lines[j] = lines[j - 1];
+
+        lines[j] = (mcumax_scored_move){
+            mcumax.root_moves[i],
+            score,
+            depth,
+        };
+    }
+}
+
+
+#define MCUMAX_ROOT_SCORING() (mcumax.root_scores_buffer_size != 0)
+#define MCUMAX_ROOT_RESTRICTED() mcumax.root_moves_restricted
+#else
+// No root move list: the root is scanned like other nodes
+static uint8_t mcumax_next_root_move(void)
+{
+    return MCUMAX_SQUARE_INVALID;
+}
+
+#define MCUMAX_ROOT_SCORING() false
+#define MCUMAX_ROOT_RESTRICTED() false
+#endif
+
+// Returns true if root move is skipped: not the current root list move, or
+// excluded by a MultiPV line found at this depth
+static bool mcumax_is_root_move_skipped(bool root_list, uint8_t square_from, uint8_t square_to)
+{
+#ifdef MCUMAX_ROOT_MOVES
+    if (root_list &&
+        (mcumax.root_moves[mcumax.root_move_index].to != square_to))
+        return true;
+#else
+    (void)root_list;
+#endif
+
+    if (mcumax.square_from != MCUMAX_SQUARE_INVALID)
+        return false;
+
+    for (uint32_t i = 0; i < mcumax.multipv_pass; i++)
+    {
+        if ((mcumax.multipv_buffer[i].move.from == square_from) &&
+            (mcumax.multipv_buffer[i].move.to == square_to))
+            return true;
+    }
+
+    return false;
+}
+
+// Pushes a child node on the node stack
+static bool mcumax_push_node(mcumax_score alpha,
+                             mcumax_score beta,
+                             mcumax_score score,
+                             uint8_t en_passant_square,
+                             uint8_t depth)
+{
+#ifdef MCUMAX_TRACE
+    mcumax.trace_flags = 0;
+#endif
+
+    // Stack full: caller uses static evaluation
+    if (mcumax.ply >= (MCUMAX_PLY_MAX - 1))
+        return false;
+
+    struct mcumax_node *node = &mcumax.stack[++mcumax.ply];
+
+    node->alpha = alpha;
+    node->beta = beta;
+    node->score = score;
+    node->en_passant_square = en_passant_square;
+    node->depth = depth;
+    node->mode = MCUMAX_INTERNAL_NODE;
+    node->state = MCUMAX_NODE_ENTER;
+
+#ifdef MCUMAX_TRACE
+    node->trace_flags = 0;
+#endif
+
+    return true;
+}
+
+#ifdef MCUMAX_TRACE
+// Appends a searched node to the trace ring
+static void mcumax_trace(uint8_t ply,
+                         uint8_t square_from,
+                         uint8_t square_to,
+                         int32_t alpha,
+                         int32_t beta,
+                         int32_t score,
+                         uint8_t depth,
+                         uint8_t flags)
+{
+    if (!mcumax.trace_buffer_size)
+        return;
+
+    mcumax_trace_record *record = &mcumax.trace_buffer[mcumax.trace_count++ % mcumax.trace_buffer_size];
+
+    record->node_count = mcumax.node_count;
+    record->alpha = alpha;
+    record->beta = beta;
+    record->score = score;
+    record->move = (mcumax_move){square_from, square_to};
+    record->ply = ply;
+    record->depth = (depth > 2) ? depth - 2 : 0;
+    record->flags = flags;
+    record->reserved = 0;
+}
+#endif
+
+// Quiescence move list entry
+struct mcumax_capture
+{
+    uint8_t square_from;
+    uint8_t square_to;
+    uint8_t order; // MVV/LVA, 0 for quiet moves
+};
+
+static struct mcumax_capture mcumax_captures[MCUMAX_QUIESCENCE_MOVES_MAX];
+static uint16_t mcumax_captures_num;
+
+// Adds a move to the quiescence move list, returns false if full
+static bool mcumax_add_capture(uint8_t square_from, uint8_t square_to, uint8_t order)
+{
+    if (mcumax_captures_num == MCUMAX_QUIESCENCE_MOVES_MAX)
+        return false;
+
+    struct mcumax_capture *capture = &mcumax_captures[mcumax_captures_num++];
+
+    capture->square_from = square_from;
+    capture->square_to = square_to;
+    capture->order = order;
+
+    return true;
+}
+
+// Adds the captures of the own piece on square_from to the move list, and
+// its quiet moves (no castling) if evading check. Returns false if the
+// opponent's king can be captured, which is not listed, or the list is full
+static bool mcumax_add_captures(uint8_t square_from, uint8_t en_passant_square, bool evading)
+{
+    uint8_t scan_piece = mcumax.board[square_from];
+    uint8_t scan_piece_type = scan_piece & 0b111;
+
+    int8_t step_vector = scan_piece_type;
+    int8_t step_vector_index = mcumax_step_vectors_indices[scan_piece_type];
+
+    // Loop over directions o[]
+    while ((step_vector = ((scan_piece_type > 2) &&
+                           (step_vector < 0))
+                              ? -step_vector
+                              : -mcumax_step_vectors[++step_vector_index]))
+    {
+        uint8_t square_to = square_from;
+        uint8_t capture_piece;
+
+        do
+        {
+            square_to += step_vector;
+
+            // Board edge hit
+            if (square_to & MCUMAX_BOARD_MASK)
+                break;
+
+            capture_piece = mcumax.board[square_to];
+
+            // Pawns capture diagonally only, or en-passant; step straight
+            // (double step if unmoved) only if evading
+            if (scan_piece_type < 3)
+            {
+                if (!((square_to - square_from) & 0b111))
+                {
+                    if (!evading || capture_piece)
+                        break;
+
+                    if (!mcumax_add_capture(square_from, square_to, 0))
+                        return false;
+
+                    if (!(scan_piece & MCUMAX_PIECE_MOVED) &&
+                        !mcumax.board[square_to + step_vector] &&
+                        !mcumax_add_capture(square_from, square_to + step_vector, 0))
+                        return false;
+
+                    break;
+                }
+
+                if (square_to == en_passant_square)
+                {
+                    capture_piece = mcumax.board[square_to ^ 16];
+
+                    if ((capture_piece & 0b111) >= 3)
+                        break;
+                }
+                else if (!capture_piece)
+                    break;
+            }
+
+            // Capture own
+            if (capture_piece & mcumax.current_side)
+                break;
+
+            if ((capture_piece & 0b111) == MCUMAX_KING)
+                return false;
+
+            if ((capture_piece || evading) &&
+                !mcumax_add_capture(square_from,
+                                    square_to,
+                                    capture_piece
+                                        ? 8 * mcumax_capture_values[capture_piece & 0b111] - scan_piece_type
+                                        : 0))
+                return false;
+
+            // Sliders continue ray until blocked
+        } while (!capture_piece &&
+                 (scan_piece_type >= 5));
+    }
+
+    return true;
+}
+
+// Quiescence search: stand pat, then captures in MVV/LVA order with delta
+// pruning; in check, all evasions and no stand pat. Runs on the C stack,
+// without node stack, hash table or null move
+// Arguments as mcumax_search nodes; returns the score
+static mcumax_score mcumax_quiesce(mcumax_score alpha,
+                                   mcumax_score beta,
+                                   mcumax_score score,
+                                   uint8_t en_passant_square,
+                                   uint8_t ply)
+{
+    // Adj. window: delay bonus
+    alpha -= alpha < score;
+    beta -= beta <= score;
+
+    mcumax.node_count++;
+
+    // Stand pat, unless in check
+    mcumax_score best_score = score;
+
+    if (ply >= MCUMAX_QUIESCENCE_PLY_MAX)
+        return best_score;
+
+    bool in_check = mcumax_is_square_attacked(mcumax.king_squares[mcumax.current_side >> 4],
+                                              mcumax.current_side ^ 0x18);
+
+    if (in_check)
+        best_score = -MCUMAX_SCORE_MAX;
+    else if (best_score >= beta)
+        return best_score;
+
+    // Generate captures (evasions); king capture: previous move illegal;
+    // list full: not expanded
+    uint16_t captures_start = mcumax_captures_num;
+    bool expanded = true;
+
+#ifdef MCUMAX_BITBOARDS
+    for (uint64_t pieces = mcumax.bitboards[mcumax.current_side >> 4];
+         pieces && expanded;
+         pieces &= pieces - 1)
+        expanded = mcumax_add_captures(MCUMAX_BITBOARD_SQUARE(mcumax_bitboard_lowest(pieces)),
+                                       en_passant_square,
+                                       in_check);
+#else
+    uint8_t square = 0;
+    do
+    {
+        if (mcumax.board[square] & mcumax.current_side)
+            expanded = mcumax_add_captures(square, en_passant_square, in_check);
+    } while (expanded &&
+             (square = (square + 9) & ~MCUMAX_BOARD_MASK));
+#endif
+
+    if (!expanded)
+    {
+        mcumax_captures_num = captures_start;
+
+        return mcumax_is_square_attacked(mcumax.king_squares[(mcumax.current_side ^ 0x18) >> 4],
+                                         mcumax.current_side)
+                   ? MCUMAX_SCORE_MAX
+                   : score;
+    }
+
+    while (mcumax_captures_num != captures_start)
+    {
+        // Pick best MVV/LVA capture
+        struct mcumax_capture *capture = &mcumax_captures[captures_start];
+
+        for (uint16_t i = captures_start + 1; i < mcumax_captures_num; i++)
+            if (mcumax_captures[i].order > capture->order)
+                capture = &mcumax_captures[i];
+
+        uint8_t square_from = capture->square_from;
+        uint8_t square_to = capture->square_to;
+
+        *capture = mcumax_captures[--mcumax_captures_num];
+
+        uint8_t scan_piece = mcumax.board[square_from];
+        uint8_t scan_piece_type = scan_piece & 0b111;
+
+        // Shift capture square if en-passant
+        uint8_t capture_square = ((scan_piece_type < 3) &&
+                                  (square_to == en_passant_square))
+                                     ? square_to ^ 16
+                                     : square_to;
+        uint8_t capture_piece = mcumax.board[capture_square];
+
+        // Value of captured piece
+        mcumax_score capture_piece_value = mcumax_piece_values[capture_piece & 0b111] +
+                                           (capture_piece & 0xc0);
+
+        // Promotion: convert to queen
+        mcumax_score promotion_value = ((scan_piece_type < 3) &&
+                                        ((square_to + (square_to - square_from) + 1) & MCUMAX_SQUARE_INVALID))
+                                           ? 647 - scan_piece_type
+                                           : 0;
+
+        mcumax_score step_alpha = (best_score > alpha)
+                                      ? best_score
+                                      : alpha;
+
+        // Delta pruning: capture cannot raise score to alpha (not evasions)
+        if (!in_check &&
+            !promotion_value &&
+            (score + capture_piece_value + MCUMAX_QUIESCENCE_DELTA_MARGIN <= step_alpha))
+            continue;
+
+        int16_t eval_mg = mcumax.eval_mg;
+        int16_t eval_eg = mcumax.eval_eg;
+        uint8_t phase = mcumax.phase;
+        uint16_t side_phases = mcumax.side_phases;
+        int16_t pawn_mg = mcumax.pawn_mg;
+        int16_t pawn_eg = mcumax.pawn_eg;
+        uint32_t pawn_key = mcumax.pawn_key;
+
+        // Do move, set non-virgin
+        mcumax.board[capture_square] =
+            mcumax.board[square_from] = 0;
+        mcumax.board[square_to] = (scan_piece | MCUMAX_PIECE_MOVED) + promotion_value;
+
+#ifdef MCUMAX_BITBOARDS
+        mcumax_move_bitboards(square_from,
+                              square_to,
+                              capture_square,
+                              capture_piece,
+                              MCUMAX_SQUARE_INVALID,
+                              MCUMAX_SQUARE_INVALID);
+#endif
+
+        if (scan_piece_type == MCUMAX_KING)
+            mcumax.king_squares[mcumax.current_side >> 4] = square_to;
+
+        mcumax_score step_score;
+
+        if (mcumax_is_move_illegal(square_from,
+                                   square_to,
+                                   capture_square,
+                                   MCUMAX_SQUARE_INVALID,
+                                   MCUMAX_SQUARE_INVALID,
+                                   in_check))
+            step_score = -MCUMAX_SCORE_MAX;
+        else
+        {
+            // Piece-square tables, game phase, pawn structure
+            mcumax_eval_piece(capture_piece, capture_square, false);
+            mcumax_eval_piece(scan_piece, square_from, false);
+            mcumax_eval_piece(mcumax.board[square_to], square_to, true);
+
+            if ((scan_piece_type < 3) ||
+                (scan_piece_type == MCUMAX_KING) ||
+                ((capture_piece & 0b111) && ((capture_piece & 0b111) < 3)))
+            {
+                mcumax.pawn_key += mcumax_pawn_scramble(square_to, mcumax.board[square_to]) -
+                                   mcumax_pawn_scramble(square_from, scan_piece) -
+                                   mcumax_pawn_scramble(capture_square, capture_piece);
+
+                mcumax_eval_pawns();
+            }
+
+            step_score = score + capture_piece_value + promotion_value +
+                         mcumax_eval_blend(mcumax.eval_mg + mcumax.pawn_mg,
+                                           mcumax.eval_eg + mcumax.pawn_eg,
+                                           mcumax.phase) -
+                         mcumax_eval_blend(eval_mg + pawn_mg, eval_eg + pawn_eg, phase);
+
+            // Reply, unless it stands pat above its beta
+            if (step_score > step_alpha)
+            {
+                mcumax.current_side ^= 0x18;
+
+                step_score = -mcumax_quiesce(-beta,
+                                             -step_alpha,
+                                             -step_score,
+                                             MCUMAX_SQUARE_INVALID,
+                                             ply + 1);
+
+                mcumax.current_side ^= 0x18;
+            }
+
+            mcumax.eval_mg = eval_mg;
+            mcumax.eval_eg = eval_eg;
+            mcumax.phase = phase;
+            mcumax.side_phases = side_phases;
+            mcumax.pawn_mg = pawn_mg;
+            mcumax.pawn_eg = pawn_eg;
+            mcumax.pawn_key = pawn_key;
+        }
+
+        // Undo move
+        mcumax.board[square_to] = 0;
+        mcumax.board[square_from] = scan_piece;
+        mcumax.board[capture_square] = capture_piece;
+
+        if (scan_piece_type == MCUMAX_KING)
+            mcumax.king_squares[mcumax.current_side >> 4] = square_from;
+
+#ifdef MCUMAX_BITBOARDS
+        mcumax_move_bitboards(square_from,
+                              square_to,
+                              capture_square,
+                              capture_piece,
+                              MCUMAX_SQUARE_INVALID,
+                              MCUMAX_SQUARE_INVALID);
+#endif
+
+        if (step_score > best_score)
+        {
+            best_score = step_score;
+
+            // Fail high
+            if (best_score >= beta)
+                break;
+        }
+    }
+
+    mcumax_captures_num = captures_start;
+
+    // Delayed-loss bonus
+    return best_score + (best_score < score);
+}
+
+// Minimax search on an explicit node stack, so it can be suspended and resumed
+// Node arguments: (alpha,beta)=window, score=current evaluation score,
+// en_passant_square=e.p. sqr., depth=depth, mode=search mode
+// Returns true when the root node finished (score in mcumax.search_score),
+// false when suspended at node_limit
+static bool mcumax_search(uint32_t node_limit)
+{
+    struct mcumax_node *node;
+
+    mcumax_score alpha;
+    mcumax_score beta;
+    mcumax_score score;
+    uint8_t en_passant_square;
+    uint8_t depth;
+    enum mcumax_mode mode;
+
+    uint8_t iter_depth;
+    mcumax_score iter_score;
+    uint8_t iter_square_from;
+    uint8_t iter_square_to;
+
+#ifdef MCUMAX_HASHING_ENABLED
+    int32_t hash_key;
+    struct HashBucket *hash_bucket;
+    struct HashEntry *hash_entry;
+#endif
+    int32_t hash_key2;
+    uint16_t halfmove_clock;
+
+    int16_t eval_mg;
+    int16_t eval_eg;
+    uint8_t phase;
+    uint16_t side_phases;
+    int16_t pawn_mg;
+    int16_t pawn_eg;
+    uint32_t pawn_key;
+    uint8_t in_check;
+
+    uint8_t square_start;
+
+    uint8_t square_from;
+    uint8_t square_to;
+
+    uint8_t replay_move;
+    mcumax_score null_move_score;
+
+    uint8_t scan_piece;
+    uint8_t scan_piece_type;
+
+    int8_t step_vector;
+    int8_t step_vector_index;
+
+    uint8_t castling_skip_square;
+    uint8_t castling_rook_square;
+
+    uint8_t capture_square;
+    uint8_t capture_piece;
+    mcumax_score capture_piece_value;
+
+    uint8_t step_depth;
+    mcumax_score step_alpha;
+    mcumax_score step_beta;
+    mcumax_score step_score;
+    mcumax_score step_score_new;
+
+    uint8_t move_index;
+
+resume:
+    // Continue node at top of stack
+    node = &mcumax.stack[mcumax.ply];
+
+    MCUMAX_NODE_VARIABLES(MCUMAX_NODE_LOAD)
+    MCUMAX_NODE_HASH_VARIABLES(MCUMAX_NODE_LOAD)
+
+    switch (node->state)
+    {
+    case MCUMAX_NODE_NULL_MOVE:
+        goto null_move_done;
+
+    case MCUMAX_NODE_NULL_MOVE_VERIFY:
+        goto null_move_verify_done;
+
+    case MCUMAX_NODE_REPLY:
+        goto reply_done;
+
+    default:
+        break;
+    }
+
+    // Out of node budget: suspend before entering node
+    if (mcumax.node_count >= node_limit)
+        return false;
+
+    if (mcumax.user_callback)
+        mcumax.user_callback(mcumax.user_data);
+
+    // Record pos. in history; repetition or fifty moves: draw
+    hash_key2 = mcumax.hash_key2;
+    halfmove_clock = mcumax.halfmove_clock;
+
+    mcumax.history_keys[mcumax.history_num + mcumax.ply] = hash_key2;
+
+    if (mcumax.ply &&
+        mcumax_is_draw(mcumax.ply, halfmove_clock))
+    {
+        mcumax.search_score = 0;
+
+#ifdef MCUMAX_TRACE
+        node->trace_flags = MCUMAX_TRACE_DRAW;
+#endif
+
+        goto done;
+    }
+
+    // Horizon (null move reply): quiescence search
+    if ((depth <= 2) &&
+        (mode == MCUMAX_INTERNAL_NODE))
+    {
+        mcumax.search_score = mcumax_quiesce(alpha, beta, score, en_passant_square, 0);
+
+#ifdef MCUMAX_TRACE
+        node->trace_flags = MCUMAX_TRACE_QUIESCENCE;
+#endif
+
+        goto done;
+    }
+
+    // Adj. window: delay bonus
+    alpha -= alpha < score;
+    beta -= beta <= score;
+
+#ifdef MCUMAX_HASHING_ENABLED
+    // Lookup pos. in hash table
+    hash_bucket = mcumax_hash_bucket(mcumax.current_side, en_passant_square);
+    hash_entry = mcumax_hash_probe(hash_bucket, MCUMAX_HASH_KEY(mcumax.hash_key2));
+
+    if (hash_entry)
+        mcumax_hash_read(hash_entry,
+                         &iter_depth,
+                         &iter_score,
+                         &iter_square_from,
+                         &iter_square_to);
+    else
+        iter_depth = iter_score = iter_square_from = iter_square_to = 0;
+
+    // Resume at stored depth
+    if (!hash_entry || // Miss: other pos. or empty
+        (mode != MCUMAX_INTERNAL_NODE) ||
+        !(((iter_score <= alpha) ||
+           (iter_square_from & 0x8)) &&
+          ((iter_score >= beta) ||
+           (iter_square_from & MCUMAX_SQUARE_INVALID)))) // Or window incompatible
+    {
+        // Start iteration from scratch
+        iter_depth =
+            iter_square_to = 0;
+    }
+
+    // Start at best-move hint
+    iter_square_from &= ~MCUMAX_BOARD_MASK;
+
+    hash_key = mcumax.hash_key;
+#else
+    iter_depth =
+        iter_score =
+            iter_square_from =
+                iter_square_to = 0;
+#endif
+
+    // Listing or playing: full-width iteration only
+    if ((mode == MCUMAX_SEARCH_VALID_MOVES) ||
+        (mode == MCUMAX_PLAY_MOVE))
+        iter_depth = 2;
+
+    eval_mg = mcumax.eval_mg;
+    eval_eg = mcumax.eval_eg;
+    phase = mcumax.phase;
+    side_phases = mcumax.side_phases;
+    pawn_mg = mcumax.pawn_mg;
+    pawn_eg = mcumax.pawn_eg;
+    pawn_key = mcumax.pawn_key;
+
+    in_check = mcumax_is_square_attacked(mcumax.king_squares[mcumax.current_side >> 4],
+                                         mcumax.current_side ^ 0x18);
+
+#ifdef MCUMAX_TRACE
+    // Stored depth suffices: no iteration
+    if ((mode == MCUMAX_INTERNAL_NODE) &&
+        (iter_depth >= depth) &&
+        (iter_depth >= 2))
+        node->trace_flags = MCUMAX_TRACE_HASH_CUT;
+#endif
+
+    // Min depth = 2 iterative deepening loop
+    // root: deepen upto time
+    // time's up: go do best
+    while ((iter_depth++ < depth) ||
+           (iter_depth < 3) ||
+           ((mode == MCUMAX_SEARCH_BEST_MOVE) &&
+            (mcumax.square_from == MCUMAX_SQUARE_INVALID) &&
+            (((mcumax.node_count < mcumax.node_max) &&
+              (iter_depth <= mcumax.depth_max)) ||
+             (mcumax.square_from = iter_square_from,
+              mcumax.square_to = iter_square_to & ~MCUMAX_BOARD_MASK,
+              iter_depth = 3))))
+    {
+        if (mcumax.stop_search)
+            break;
+
+#ifdef MCUMAX_ROOT_MOVES
+        if (!mcumax.ply &&
+            (mode == MCUMAX_SEARCH_BEST_MOVE) &&
+            (mcumax.square_from == MCUMAX_SQUARE_INVALID) &&
+            mcumax.root_moves_num)
+        {
+            // Root move list: scan in list order
+            square_start = MCUMAX_SQUARE_INVALID;
+            square_from = mcumax_begin_root_moves();
+        }
+        else
+#endif
+        {
+            // Start scan at previous best (listing: at square 0; playing: at move)
+            square_from =
+                square_start = (mode == MCUMAX_SEARCH_VALID_MOVES)
+                                   ? 0
+                               : (mode == MCUMAX_PLAY_MOVE)
+                                   ? (mcumax.square_from & ~MCUMAX_BOARD_MASK)
+                                   : iter_square_from;
+        }
+
+        // Request try noncastling first (not when listing from square 0 or root list)
+        replay_move = ((mode != MCUMAX_SEARCH_VALID_MOVES) &&
+                       (square_start != MCUMAX_SQUARE_INVALID))
+                          ? (iter_square_to & MCUMAX_SQUARE_INVALID)
+                          : 0;
+
+        // Change side
+        mcumax.current_side ^= 0x18;
+
+        // Search null move: not in check, not below beta, not with pawns only
+        // (zugzwang), not within a verification search
+        if ((iter_depth > 2) &&
+            (beta != -MCUMAX_SCORE_MAX) &&
+            !in_check &&
+            (score >= beta) &&
+            ((side_phases >> (mcumax.current_side & 0x10 ? 0 : 8)) & 0xff) &&
+            (mcumax.ply >= mcumax.null_move_ply_min))
+        {
+            node->state = MCUMAX_NODE_NULL_MOVE;
+            MCUMAX_NODE_VARIABLES(MCUMAX_NODE_SAVE)
+            MCUMAX_NODE_HASH_VARIABLES(MCUMAX_NODE_SAVE)
+
+            // Repetitions across the null move are not draws
+            mcumax.halfmove_clock = 0;
+
+            if (mcumax_push_node(-beta,
+                                 1 - beta,
+                                 -score,
+                                 MCUMAX_SQUARE_INVALID,
+                                 mcumax_null_move_depth(iter_depth, score, beta)))
+                goto resume;
+
+            mcumax.search_score = -score;
+
+        null_move_done:
+            null_move_score = mcumax.search_score;
+            mcumax.halfmove_clock = halfmove_clock;
+
+#ifdef MCUMAX_TRACE
+            mcumax_trace(mcumax.ply + 1,
+                         MCUMAX_SQUARE_INVALID,
+                         MCUMAX_SQUARE_INVALID,
+                         -beta,
+                         1 - beta,
+                         null_move_score,
+                         mcumax_null_move_depth(iter_depth, score, beta),
+                         mcumax.trace_flags | MCUMAX_TRACE_NULL_MOVE);
+#endif
+        }
+        else
+            null_move_score = MCUMAX_SCORE_MAX;
+
+        // Change side
+        mcumax.current_side ^= 0x18;
+
+        // Null move fail high at high depth: verify with reduced search without null moves
+        if ((-null_move_score >= beta) &&
+            (iter_depth >= MCUMAX_NULL_MOVE_VERIFY_DEPTH) &&
+            !mcumax.null_move_ply_min)
+        {
+            mcumax.null_move_ply_min = mcumax.ply + 1 +
+                                       3 * (mcumax_null_move_depth(iter_depth, score, beta) - 1) / 4;
+
+            node->state = MCUMAX_NODE_NULL_MOVE_VERIFY;
+            MCUMAX_NODE_VARIABLES(MCUMAX_NODE_SAVE)
+            MCUMAX_NODE_HASH_VARIABLES(MCUMAX_NODE_SAVE)
+
+            mcumax.halfmove_clock = 0;
+
+            if (mcumax_push_node(beta - 1,
+                                 beta,
+                                 score,
+                                 en_passant_square,
+                                 mcumax_null_move_depth(iter_depth, score, beta) + 1))
+                goto resume;
+
+            mcumax.search_score = score;
+
+        null_move_verify_done:
+            mcumax.null_move_ply_min = 0;
+            mcumax.halfmove_clock = halfmove_clock;
+
+#ifdef MCUMAX_TRACE
+            mcumax_trace(mcumax.ply + 1,
+                         MCUMAX_SQUARE_INVALID,
+                         MCUMAX_SQUARE_INVALID,
+                         beta - 1,
+                         beta,
+                         mcumax.search_score,
+                         mcumax_null_move_depth(iter_depth, score, beta) + 1,
+                         mcumax.trace_flags | MCUMAX_TRACE_VERIFY);
+#endif
+
+            if (mcumax.search_score < beta)
+                null_move_score = MCUMAX_SCORE_MAX;
+        }
+
+        move_index = 0;
+
+        // Prune if > beta unconsidered:static eval
+        iter_score = (-null_move_score < beta)
+                         ? (iter_depth - 2)
+                               ? -MCUMAX_SCORE_MAX
+                               : score
+                         : -null_move_score;
+
+        // Node count (for timing)
+        mcumax.node_count++;
+
+        do
+        {
+            // Scan board looking for
+            scan_piece = mcumax.board[square_from];
+
+            // Own piece (inefficient!)
+            if (scan_piece & mcumax.current_side)
+            {
+                // p = piece type (set r>0)
+                step_vector = scan_piece_type = (scan_piece & 0b111);
+
+                // First step vector for piece
+                step_vector_index = mcumax_step_vectors_indices[scan_piece_type];
+
+                // Loop over directions o[]
+                while ((step_vector = ((scan_piece_type > 2) &&
+                                       (step_vector < 0))
+                                          ? -step_vector
+                                          : -mcumax_step_vectors[++step_vector_index]))
+                {
+                replay:
+                    // Resume normal after best
+                    square_to = square_from;
+
+                    castling_skip_square =
+                        castling_rook_square = MCUMAX_SQUARE_INVALID;
+
+                    // y traverses ray, or:
+                    do
+                    {
+                        // Sneak in previous best move
+                        capture_square =
+                            square_to =
+                                replay_move
+                                    ? (iter_square_to ^ replay_move)
+                                    : (square_to + step_vector);
+
+                        // Board edge hit
+                        if (square_to & MCUMAX_BOARD_MASK)
+                            break;
+
+                        // Shift capture square if en-passant
+                        if ((scan_piece_type < 3) &&
+                            (square_to == en_passant_square))
+                            capture_square ^= 16;
+
+                        capture_piece = mcumax.board[capture_square];
+
+                        // Capture own, bad pawn mode
+                        if ((capture_piece & mcumax.current_side) ||
+                            ((scan_piece_type < 3) &&
+                             !((square_to - square_from) & 0b111) - !capture_piece))
+                            break;
+
+                        // Value of captured piece
+                        capture_piece_value = mcumax_piece_values[capture_piece & 0b111] +
+                                              (capture_piece & 0xc0);
+
+                        // King capture
+                        if (capture_piece_value < 0)
+                        {
+                            iter_score = MCUMAX_SCORE_MAX;
+                            iter_depth = MCUMAX_DEPTH_MAX - 1;
+                        }
+
+                        // Abort on fail high
+                        if ((iter_score >= beta) &&
+                            (iter_depth > 1))
+                            goto cutoff;
+
+                        // MVV/LVA scoring if depth == 1
+                        step_score = (iter_depth != 1)
+                                         ? score
+                                         : capture_piece_value - scan_piece_type;
+
+                        // Root move list, MultiPV, playing: skip other root moves
+                        if (!mcumax.ply &&
+                            ((mode == MCUMAX_PLAY_MOVE)
+                                 ? ((square_from != mcumax.square_from) ||
+                                    (square_to != mcumax.square_to))
+                                 : mcumax_is_root_move_skipped(square_start == MCUMAX_SQUARE_INVALID,
+                                                               square_from,
+                                                               square_to)))
+                            step_score = -MCUMAX_SCORE_MAX;
+
+                        // All captures if depth == 2
+                        else if ((iter_depth - !capture_piece) > 1)
+                        {
+                            step_score = 0;
+
+                            mcumax.board[castling_rook_square] =
+                                mcumax.board[capture_square] =
+                                    mcumax.board[square_from] = 0;
+
+                            // Do move, set non-virgin
+                            mcumax.board[square_to] = scan_piece | MCUMAX_PIECE_MOVED;
+
+#ifdef MCUMAX_BITBOARDS
+                            mcumax_move_bitboards(square_from,
+                                                  square_to,
+                                                  capture_square,
+                                                  capture_piece,
+                                                  castling_rook_square,
+                                                  castling_skip_square);
+#endif
+
+                            if (scan_piece_type == MCUMAX_KING)
+                                mcumax.king_squares[mcumax.current_side >> 4] = square_to;
+
+                            // Castling: put rook & score
+                            if (!(castling_rook_square & MCUMAX_BOARD_MASK))
+                            {
+                                mcumax.board[castling_skip_square] = mcumax.current_side + 6;
+                                step_score += MCUMAX_CASTLING_BONUS;
+
+                                mcumax_eval_piece(mcumax.current_side + 6, castling_rook_square, false);
+                                mcumax_eval_piece(mcumax.current_side + 6, castling_skip_square, true);
+                            }
+
+                            // Promotion: convert to queen
+                            if ((scan_piece_type < 3) &&
+                                ((square_to + step_vector + 1) & MCUMAX_SQUARE_INVALID))
+                            {
+                                capture_piece_value +=
+                                    step_alpha = 647 - scan_piece_type;
+
+                                mcumax.board[square_to] += step_alpha;
+                            }
+
+                            // Piece-square tables, game phase
+                            mcumax_eval_piece(capture_piece, capture_square, false);
+                            mcumax_eval_piece(scan_piece, square_from, false);
+                            mcumax_eval_piece(mcumax.board[square_to], square_to, true);
+
+                            // Pawn structure, king shelter: on pawn and king moves, pawn captures
+                            if ((scan_piece_type < 3) ||
+                                (scan_piece_type == MCUMAX_KING) ||
+                                ((capture_piece & 0b111) && ((capture_piece & 0b111) < 3)))
+                            {
+                                mcumax.pawn_key += mcumax_pawn_scramble(square_to, mcumax.board[square_to]) -
+                                                   mcumax_pawn_scramble(square_from, scan_piece) -
+                                                   mcumax_pawn_scramble(capture_square, capture_piece);
+
+                                mcumax_eval_pawns();
+                            }
+
+                            step_score += mcumax_eval_blend(mcumax.eval_mg + mcumax.pawn_mg,
+                                                            mcumax.eval_eg + mcumax.pawn_eg,
+                                                            mcumax.phase) -
+                                          mcumax_eval_blend(eval_mg + pawn_mg, eval_eg + pawn_eg, phase);
+
+                            mcumax.hash_key2 += Hash(8);
+#ifdef MCUMAX_HASHING_ENABLED
+                            mcumax.hash_key += Hash(0);
+#endif
+
+                            // Castling: hash rook, so keys depend on position only
+                            if (!(castling_rook_square & MCUMAX_BOARD_MASK))
+                            {
+                                mcumax.hash_key2 += HashScramble(castling_skip_square + 8, mcumax.current_side + 6) -
+                                                    HashScramble(castling_rook_square + 8, mcumax.current_side + 6);
+#ifdef MCUMAX_HASHING_ENABLED
+                                mcumax.hash_key += HashScramble(castling_skip_square + 0, mcumax.current_side + 6) -
+                                                   HashScramble(castling_rook_square + 0, mcumax.current_side + 6);
+#endif
+                            }
+
+                            // Captures and pawn moves are irreversible
+                            mcumax.halfmove_clock = (capture_piece || (scan_piece_type < 3))
+                                                        ? 0
+                                                        : halfmove_clock + 1;
+
+#ifdef MCUMAX_HASHING_ENABLED
+
+                            // Fetch child's bucket while the move is checked
+                            MCUMAX_HASH_PREFETCH(mcumax_hash_bucket(mcumax.current_side ^ 0x18,
+                                                                    castling_skip_square));
+#endif
+
+                            // Illegal: own king left attacked
+                            if (mcumax_is_move_illegal(square_from,
+                                                       square_to,
+                                                       capture_square,
+                                                       castling_rook_square,
+                                                       castling_skip_square,
+                                                       in_check))
+                            {
+                                step_score = -MCUMAX_SCORE_MAX;
+
+                                goto move_done;
+                            }
+
+                            // New score & alpha (scoring root moves: keep root window open)
+                            step_score += score + capture_piece_value;
+                            step_alpha = ((iter_score > alpha) &&
+                                          (mcumax.ply || !MCUMAX_ROOT_SCORING()))
+                                             ? iter_score
+                                             : alpha;
+                            step_beta = beta;
+
+#ifdef MCUMAX_ROOT_MOVES
+                            // Scoring root moves: aspiration window at the move's last score
+                            if (!mcumax.ply &&
+                                MCUMAX_ROOT_SCORING() &&
+                                (square_start == MCUMAX_SQUARE_INVALID) &&
+                                (iter_depth > 3) &&
+                                (mcumax.root_move_scores[mcumax.root_move_index] > -MCUMAX_SCORE_MAX / 2) &&
+                                (mcumax.root_move_scores[mcumax.root_move_index] < MCUMAX_SCORE_MAX / 2))
+                            {
+                                step_alpha = mcumax.root_move_scores[mcumax.root_move_index] - MCUMAX_ROOT_SCORES_WINDOW;
+                                step_beta = mcumax.root_move_scores[mcumax.root_move_index] + MCUMAX_ROOT_SCORES_WINDOW;
+                            }
+#endif
+
+                            // New depth, late move reduction of quiet non-pawn moves;
+                            // not PV move, killer, check, or root move being scored
+                            step_depth = iter_depth - 1;
+
+                            if ((iter_depth >= MCUMAX_LMR_DEPTH_MIN + 2) &&
+                                (move_index >= MCUMAX_LMR_MOVES_MIN) &&
+                                (mcumax.ply || !MCUMAX_ROOT_SCORING()) &&
+                                (scan_piece_type > 2) &&
+                                !capture_piece &&
+                                !replay_move &&
+                                !in_check &&
+                                ((square_from != mcumax.killer_moves[mcumax.ply].from) ||
+                                 (square_to != mcumax.killer_moves[mcumax.ply].to)) &&
+                                !mcumax_is_square_attacked(mcumax.king_squares[(mcumax.current_side ^ 0x18) >> 4],
+                                                           mcumax.current_side))
+                                step_depth -= mcumax_get_reduction(iter_depth - 2, move_index);
+
+                            move_index++;
+
+#ifdef MCUMAX_TRACE
+                            node->trace_replies = 0;
+#endif
+
+                            // Extend 1 ply if in check
+                            if (!((mcumax.phase < MCUMAX_PHASE_ENDGAME) ||
+                                  !in_check ||
+                                  (iter_depth < 3) ||
+                                  (capture_piece &&
+                                   (scan_piece_type != 4))))
+                                step_depth = iter_depth;
+
+                            // Futility, recursive evaluation of reply
+                            do
+                            {
+                                // Change side
+                                mcumax.current_side ^= 0x18;
+
+                                if ((mode == MCUMAX_SEARCH_VALID_MOVES) ||
+                                    (mode == MCUMAX_PLAY_MOVE))
+                                {
+                                    // Listing or playing: move is legal, no reply needed
+                                    step_score_new = step_score;
+                                }
+                                else if (step_depth <= 2)
+                                {
+                                    // Horizon: quiescence search, unless reply stands pat
+                                    // above its beta; repetition or fifty moves: draw
+                                    step_score_new = step_score;
+
+#ifdef MCUMAX_TRACE
+                                    mcumax.trace_flags = MCUMAX_TRACE_QUIESCENCE;
+#endif
+
+                                    if (step_score > step_alpha)
+                                    {
+                                        mcumax.history_keys[mcumax.history_num + mcumax.ply + 1] = mcumax.hash_key2;
+
+                                        if (mcumax_is_draw(mcumax.ply + 1, mcumax.halfmove_clock))
+                                        {
+                                            step_score_new = 0;
+
+#ifdef MCUMAX_TRACE
+                                            mcumax.trace_flags = MCUMAX_TRACE_DRAW;
+#endif
+                                        }
+                                        else
+                                            step_score_new = -mcumax_quiesce(-step_beta,
+                                                                              -step_alpha,
+                                                                              -step_score,
+                                                                              castling_skip_square,
+                                                                              0);
+                                    }
+                                }
+                                else
+                                {
+                                    node->state = MCUMAX_NODE_REPLY;
+                                    MCUMAX_NODE_VARIABLES(MCUMAX_NODE_SAVE)
+                                    MCUMAX_NODE_HASH_VARIABLES(MCUMAX_NODE_SAVE)
+
+                                    if (mcumax_push_node(-step_beta,
+                                                         -step_alpha,
+                                                         -step_score,
+                                                         castling_skip_square,
+                                                         step_depth))
+                                        goto resume;
+
+                                    mcumax.search_score = -step_score;
+
+                                reply_done:
+                                    step_score_new = -mcumax.search_score;
+                                }
+
+#ifdef MCUMAX_TRACE
+                                if ((mode == MCUMAX_INTERNAL_NODE) ||
+                                    (mode == MCUMAX_SEARCH_BEST_MOVE))
+                                    mcumax_trace(mcumax.ply + 1,
+                                                 square_from,
+                                                 square_to,
+                                                 -step_beta,
+                                                 -step_alpha,
+                                                 -step_score_new,
+                                                 step_depth,
+                                                 mcumax.trace_flags |
+                                                     MCUMAX_TRACE_REDUCED * (step_depth < iter_depth - 1) |
+                                                     MCUMAX_TRACE_RESEARCH * (node->trace_replies++ > 0));
+#endif
+
+                                // Change side
+                                mcumax.current_side ^= 0x18;
+                            } while (((step_beta != beta) &&
+                                      ((step_score_new <= step_alpha) ||
+                                       (step_score_new >= step_beta)))
+                                         // Aspiration window failed: re-search with open window
+                                         ? (step_alpha = alpha, step_beta = beta, true)
+                                         : ((step_score_new > alpha) &&
+                                            // Deepen; if reduced, verify at full depth
+                                            ((step_depth = (step_depth + 1 < iter_depth - 1)
+                                                               ? iter_depth - 1
+                                                               : step_depth + 1) < iter_depth)));
+
+                            // No fail: re-search unreduced
+                            step_score = step_score_new;
+
+                        move_done:
+#ifdef MCUMAX_ROOT_MOVES
+                            // Scoring root moves: record score
+                            if (!mcumax.ply &&
+                                MCUMAX_ROOT_SCORING() &&
+                                (square_start == MCUMAX_SQUARE_INVALID))
+                                mcumax.root_move_scores[mcumax.root_move_index] = step_score;
+#endif
+
+                            if ((mode == MCUMAX_PLAY_MOVE) &&
+                                (step_score != -MCUMAX_SCORE_MAX) &&
+                                (square_from == mcumax.square_from) &&
+                                (square_to == mcumax.square_to))
+                            {
+                                // Playing move
+                                mcumax.score = -score - capture_piece_value;
+                                mcumax.en_passant_square = castling_skip_square;
+
+                                if (mcumax.current_side == MCUMAX_BOARD_BLACK)
+                                    mcumax.fullmove_number++;
+
+                                // Game history: positions since the last irreversible move
+                                if (!mcumax.halfmove_clock)
+                                    mcumax.history_num = 0;
+                                else if (mcumax.history_num < MCUMAX_HISTORY_GAME_MAX)
+                                    mcumax.history_num++;
+                                else
+                                    memmove(mcumax.history_keys,
+                                            mcumax.history_keys + 1,
+                                            MCUMAX_HISTORY_GAME_MAX * sizeof(uint32_t));
+
+                                // Change side
+                                mcumax.current_side ^= 0x18;
+
+                                // Move played
+                                mcumax.search_score = beta;
+
+                                goto done;
+                            }
+
+#ifdef MCUMAX_HASHING_ENABLED
+                            mcumax.hash_key = hash_key;
+#endif
+                            mcumax.hash_key2 = hash_key2;
+                            mcumax.halfmove_clock = halfmove_clock;
+
+                            mcumax.eval_mg = eval_mg;
+                            mcumax.eval_eg = eval_eg;
+                            mcumax.phase = phase;
+                            mcumax.side_phases = side_phases;
+                            mcumax.pawn_mg = pawn_mg;
+                            mcumax.pawn_eg = pawn_eg;
+                            mcumax.pawn_key = pawn_key;
+
+                            // Undo move
+                            mcumax.board[castling_rook_square] = mcumax.current_side + 6;
+                            mcumax.board[castling_skip_square] = mcumax.board[square_to] = 0;
+                            mcumax.board[square_from] = scan_piece;
+                            mcumax.board[capture_square] = capture_piece;
+
+                            if (scan_piece_type == MCUMAX_KING)
+                                mcumax.king_squares[mcumax.current_side >> 4] = square_from;
+
+#ifdef MCUMAX_BITBOARDS
+                            mcumax_move_bitboards(square_from,
+                                                  square_to,
+                                                  capture_square,
+                                                  capture_piece,
+                                                  castling_rook_square,
+                                                  castling_skip_square);
+#endif
+
+                            if ((mode == MCUMAX_SEARCH_BEST_MOVE) &&
+                                (step_score != -MCUMAX_SCORE_MAX) &&
+                                (square_from == mcumax.square_from) &&
+                                (square_to == mcumax.square_to))
+                            {
+                                // Searching best move
+                                mcumax.search_score = beta;
+
+                                goto done;
+                            }
+
+                            if ((mode == MCUMAX_SEARCH_VALID_MOVES) &&
+                                (step_score != -MCUMAX_SCORE_MAX) &&
+                                (mcumax.square_from == MCUMAX_SQUARE_INVALID) &&
+                                (iter_depth == 3) &&
+                                !replay_move)
+                            {
+                                // Searching valid moves
+                                mcumax_move move = {square_from, square_to};
+
+                                if (mcumax.valid_moves_num < mcumax.valid_moves_buffer_size)
+                                    mcumax.valid_moves_buffer[mcumax.valid_moves_num] = move;
+
+                                mcumax.valid_moves_num++;
+                            }
+                        }
+
+                        // New best, update max,best
+                        if (step_score > iter_score)
+                        {
+                            // Mark non-double
+                            iter_score = step_score;
+                            iter_square_from = square_from;
+                            iter_square_to = square_to |
+                                             (castling_skip_square & MCUMAX_SQUARE_INVALID);
+                        }
+
+                        if (replay_move)
+                        {
+                            // Redo after doing old best
+                            replay_move = 0;
+
+                            goto replay;
+                        }
+
+                        // Not first step, moved before
+                        if ((square_from + step_vector - square_to) ||
+                            (scan_piece & MCUMAX_PIECE_MOVED) ||
+                            // No pawn and no lateral king move
+                            ((scan_piece_type > 2) &&
+                             (((scan_piece_type != 4) ||
+                               (step_vector_index != 7) ||
+                               // No virgin rook in corner
+                               (mcumax.board[castling_rook_square =
+                                                 ((square_from + 3) ^
+                                                  ((step_vector >> 1) & 0b111))] -
+                                mcumax.current_side - 6) ||
+                               // No two empty squares next to rook
+                               mcumax.board[castling_rook_square ^ 1] ||
+                               mcumax.board[castling_rook_square ^ 2]))))
+                            // Fake capture for nonsliding
+                            capture_piece += (scan_piece_type < 5);
+                        else
+                            // Enable en-passant
+                            castling_skip_square = square_to;
+
+                        // If no capture, continue ray
+                    } while (!capture_piece);
+                }
+            }
+
+            // Next square of board, wrap (root move list: next root move)
+#ifdef MCUMAX_BITBOARDS
+        } while ((square_from = (square_start == MCUMAX_SQUARE_INVALID)
+                                    ? mcumax_next_root_move()
+                                    : mcumax_next_piece(square_from, square_start)) != square_start);
+#else
+        } while ((square_from = (square_start == MCUMAX_SQUARE_INVALID)
+                                    ? mcumax_next_root_move()
+                                    : ((square_from + 9) & ~MCUMAX_BOARD_MASK)) != square_start);
+#endif
+
+    cutoff:
+        // Quiet move failed high: killer
+        if ((iter_score >= beta) &&
+            !mcumax.board[iter_square_to & ~MCUMAX_BOARD_MASK])
+            mcumax.killer_moves[mcumax.ply] = (mcumax_move){
+                iter_square_from,
+                iter_square_to & ~MCUMAX_BOARD_MASK,
+            };
+
+        // Best move of last completed root iteration
+        if ((mode == MCUMAX_SEARCH_BEST_MOVE) &&
+            !mcumax.stop_search &&
+            (mcumax.square_from == MCUMAX_SQUARE_INVALID) &&
+            (iter_depth >= 3) &&
+            !mcumax.multipv_pass &&
+            (iter_score > -MCUMAX_SCORE_MAX) &&
+            (iter_score < MCUMAX_SCORE_MAX))
+        {
+            mcumax.best_move.from = iter_square_from;
+            mcumax.best_move.to = iter_square_to & ~MCUMAX_BOARD_MASK;
+            mcumax.best_move_depth = iter_depth - 2;
+        }
+
+#ifdef MCUMAX_TRACE
+        // Root iteration
+        if (!mcumax.ply &&
+            (mode == MCUMAX_SEARCH_BEST_MOVE))
+            mcumax_trace(0,
+                         iter_square_from,
+                         iter_square_to & ~MCUMAX_BOARD_MASK,
+                         alpha,
+                         beta,
+                         iter_score,
+                         iter_depth,
+                         0);
+#endif
+
+        // MultiPV: record line, search same depth again without it
+        if ((mode == MCUMAX_SEARCH_BEST_MOVE) &&
+            mcumax.multipv_buffer_size &&
+            !mcumax.stop_search &&
+            (mcumax.square_from == MCUMAX_SQUARE_INVALID) &&
+            (iter_depth >= 3))
+        {
+            // Best line keeps its replay flag
+            if ((iter_score > -MCUMAX_SCORE_MAX) &&
+                !mcumax_add_multipv_line((mcumax_scored_move){
+                    {iter_square_from, iter_square_to & ~MCUMAX_BOARD_MASK},
+                    iter_score,
+                    iter_depth - 2,
+                }))
+                mcumax.multipv_square_to = iter_square_to;
+
+            bool lines_found = mcumax.multipv_pass;
+
+            if ((iter_score > -MCUMAX_SCORE_MAX) &&
+                (mcumax.multipv_pass < mcumax.multipv_buffer_size))
+                iter_depth--;
+            else
+            {
+                mcumax.multipv_num = mcumax.multipv_pass;
+                mcumax.multipv_pass = 0;
+            }
+
+            // Deepen from best line
+            if (lines_found)
+            {
+                iter_score = mcumax.multipv_buffer[0].score;
+                iter_square_from = mcumax.multipv_buffer[0].move.from;
+                iter_square_to = mcumax.multipv_square_to;
+            }
+        }
+
+#ifdef MCUMAX_ROOT_MOVES
+        // Scoring root moves: scores of completed iteration
+        if ((mode == MCUMAX_SEARCH_BEST_MOVE) &&
+            MCUMAX_ROOT_SCORING() &&
+            !mcumax.stop_search &&
+            (square_start == MCUMAX_SQUARE_INVALID) &&
+            (iter_depth >= 3))
+            mcumax_set_root_scores(iter_depth - 2);
+
+        // Root move list: reorder for next depth
+        if ((square_start == MCUMAX_SQUARE_INVALID) &&
+            !mcumax.multipv_pass)
+            mcumax_sort_root_moves(iter_square_from,
+                                   iter_square_to & ~MCUMAX_BOARD_MASK);
+#endif
+
+        // No legal move and not in check: stalemate
+        if ((iter_score == -MCUMAX_SCORE_MAX) &&
+            (iter_depth > 2) &&
+            !in_check)
+            iter_score = 0;
+
+#ifdef MCUMAX_HASHING_ENABLED
+        // Re-probe: children may have replaced entries in this bucket
+        hash_entry = mcumax_hash_replace(hash_bucket, MCUMAX_HASH_KEY(hash_key2));
+
+        // Not from listing or restricted root; move, type (bound/exact)
+        if (mcumax.ply ||
+            ((mode == MCUMAX_SEARCH_BEST_MOVE) &&
+             !MCUMAX_ROOT_RESTRICTED()))
+            mcumax_hash_write(hash_entry,
+                              MCUMAX_HASH_KEY(hash_key2),
+                              iter_depth,
+                              iter_score,
+                              iter_square_from |
+                                  8 * (iter_score > alpha) |
+                                  MCUMAX_SQUARE_INVALID * (iter_score < beta),
+                              iter_square_to);
+#endif
+
+        // Kibitz
+        // if (in_root)
+        //     printf("%2d %6d %10d %c%c%c%c\n",
+        //         iter_depth - 2,
+        //         iter_score,
+        //         mcumax.node_count,
+        //         'a' + (iter_square_from & 0b111),
+        //         '8' - (iter_square_from >> 4),
+        //         'a' + (iter_square_to & 0b111),
+        //         '8' - (iter_square_to >> 4 & 0b111));
+    }
+
+    // Delayed-loss bonus
+    mcumax.search_score = iter_score + (iter_score < score);
+
+done:
+#ifdef MCUMAX_TRACE
+    mcumax.trace_flags = node->trace_flags;
+#endif
+
+    // Return to parent node
+    if (!mcumax.ply)
+        return true;
+
+    mcumax.ply--;
+
+    goto resume;
+}
+
+/***************************************************************************/
+
+void mcumax_init()
+{
+    for (uint32_t x = 0; x < 8; x++)
+    {
+        // Setup pieces (left side)
+        mcumax.board[0x10 * 0 + x] = MCUMAX_BOARD_BLACK | mcumax_board_setup[x];
+        mcumax.board[0x10 * 1 + x] = MCUMAX_BOARD_BLACK | MCUMAX_PAWN_DOWNSTREAM;
+        for (uint32_t y = 2; y < 6; y++)
+            mcumax.board[0x10 * y + x] = MCUMAX_EMPTY;
+        mcumax.board[0x10 * 6 + x] = MCUMAX_BOARD_WHITE | MCUMAX_PAWN_UPSTREAM;
+        mcumax.board[0x10 * 7 + x] = MCUMAX_BOARD_WHITE | mcumax_board_setup[x];
+    }
+    mcumax.current_side = MCUMAX_BOARD_WHITE;
+
+    mcumax.score = 0;
+    mcumax.en_passant_square = MCUMAX_SQUARE_INVALID;
+
+    // New game history; hash entries are keyed by position, so they outlive the game
+    mcumax.halfmove_clock = 0;
+    mcumax.history_num = 0;
+    mcumax.fullmove_number = 1;
+
+#ifdef MCUMAX_BITBOARDS
+    mcumax_init_bitboards();
+#endif
+
+    mcumax_init_eval();
+    mcumax_init_king_squares();
+    mcumax_init_hash_keys();
+}
+
+static mcumax_square mcumax_set_piece(mcumax_square square, mcumax_piece piece)
+{
+    if (square & MCUMAX_BOARD_MASK)
+        return square;
+
+    // Pawns on their start rank may still double-step
+    bool pawn_unmoved = (((piece & 0b111) == MCUMAX_PAWN_UPSTREAM) &&
+                         ((square & 0x70) == 0x60)) ||
+                        (((piece & 0b111) == MCUMAX_PAWN_DOWNSTREAM) &&
+                         ((square & 0x70) == 0x10));
+
+    mcumax.board[square] = (piece && !pawn_unmoved) ? (piece | MCUMAX_PIECE_MOVED) : piece;
+
+    return square + 1;
+}
+
+mcumax_piece mcumax_get_piece(mcumax_square square)
+{
+    if (square & MCUMAX_BOARD_MASK)
+        return MCUMAX_EMPTY;
+
+    return (mcumax.board[square] & 0xf) ^ MCUMAX_BLACK;
+}
+
+void mcumax_set_fen_position(const char *fen_string)
+{
+    mcumax_init();
+
+    uint32_t field_index = 0;
+    uint32_t board_index = 0;
+
+    mcumax.fullmove_number = 0;
+
+    char c;
+    while ((c = *fen_string++))
+    {
+        if (c == ' ')
+        {
+            if (field_index < 5)
+                field_index++;
+
+            continue;
+        }
+
+        switch (field_index)
+        {
+        case 0:
+            if (board_index < 0x80)
+            {
+                switch (c)
+                {
+                case '8':
+                case '7':
+                case '6':
+                case '5':
+                case '4':
+                case '3':
+                case '2':
+                case '1':
+                    for (int32_t i = 0; i < (c - '0'); i++)
+                        board_index = mcumax_set_piece(board_index, MCUMAX_EMPTY);
+
+                    break;
+
+                case 'P':
+                    board_index = mcumax_set_piece(board_index, MCUMAX_PAWN_UPSTREAM | MCUMAX_BOARD_WHITE);
+
+                    break;
+
+                case 'N':
+                    board_index = mcumax_set_piece(board_index, MCUMAX_KNIGHT | MCUMAX_BOARD_WHITE);
+
+                    break;
+
+                case 'B':
+                    board_index = mcumax_set_piece(board_index, MCUMAX_BISHOP | MCUMAX_BOARD_WHITE);
+
+                    break;
+
+                case 'R':
+                    board_index = mcumax_set_piece(board_index, MCUMAX_ROOK | MCUMAX_BOARD_WHITE);
+
+                    break;
+
+                case 'Q':
+                    board_index = mcumax_set_piece(board_index, MCUMAX_QUEEN | MCUMAX_BOARD_WHITE);
+
+                    break;
+
+                case 'K':
+                    board_index = mcumax_set_piece(board_index, MCUMAX_KING | MCUMAX_BOARD_WHITE);
+
+                    break;
+
+                case 'p':
+                    board_index = mcumax_set_piece(board_index, MCUMAX_PAWN_DOWNSTREAM | MCUMAX_BOARD_BLACK);
+
+                    break;
+
+                case 'n':
+                    board_index = mcumax_set_piece(board_index, MCUMAX_KNIGHT | MCUMAX_BOARD_BLACK);
+
+                    break;
+
+                case 'b':
+                    board_index = mcumax_set_piece(board_index, MCUMAX_BISHOP | MCUMAX_BOARD_BLACK);
+
+                    break;
+
+                case 'r':
+                    board_index = mcumax_set_piece(board_index, MCUMAX_ROOK | MCUMAX_BOARD_BLACK);
+
+                    break;
+
+                case 'q':
+                    board_index = mcumax_set_piece(board_index, MCUMAX_QUEEN | MCUMAX_BOARD_BLACK);
+
+                    break;
+
+                case 'k':
+                    board_index = mcumax_set_piece(board_index, MCUMAX_KING | MCUMAX_BOARD_BLACK);
+
+                    break;
+
+                case '/':
+                    board_index = (board_index < 0x80) ? (board_index & 0xf0) + 0x10 : board_index;
+
+                    break;
+                }
+            }
+            break;
+
+        case 1:
+            switch (c)
+            {
+            case 'w':
+                mcumax.current_side = MCUMAX_BOARD_WHITE;
+
+                break;
+
+            case 'b':
+                mcumax.current_side = MCUMAX_BOARD_BLACK;
+
+                break;
+            }
+            break;
+
+        case 2:
+            switch (c)
+            {
+            case 'K':
+                mcumax.board[0x74] &= ~MCUMAX_PIECE_MOVED;
+                mcumax.board[0x77] &= ~MCUMAX_PIECE_MOVED;
+
+                break;
+
+            case 'Q':
+                mcumax.board[0x74] &= ~MCUMAX_PIECE_MOVED;
+                mcumax.board[0x70] &= ~MCUMAX_PIECE_MOVED;
+
+                break;
+
+            case 'k':
+                mcumax.board[0x04] &= ~MCUMAX_PIECE_MOVED;
+                mcumax.board[0x07] &= ~MCUMAX_PIECE_MOVED;
+
+                break;
+
+            case 'q':
+                mcumax.board[0x04] &= ~MCUMAX_PIECE_MOVED;
+                mcumax.board[0x00] &= ~MCUMAX_PIECE_MOVED;
+
+                break;
+            }
+
+            break;
+
+        case 3:
+            switch (c)
+            {
+            case 'a':
+            case 'b':
+            case 'c':
+            case 'd':
+            case 'e':
+            case 'f':
+            case 'g':
+            case 'h':
+                mcumax.en_passant_square &= 0x7f;
+                mcumax.en_passant_square |= (c - 'a');
+
+                break;
+
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+                mcumax.en_passant_square &= 0x7f;
+                mcumax.en_passant_square |= 16 * ('8' - c);
+
+                break;
+            }
+
+            break;
+
+        case 4:
+            // Halfmove clock, saturated at the fifty-move draw
+            if ((c >= '0') && (c <= '9'))
+            {
+                mcumax.halfmove_clock = 10 * mcumax.halfmove_clock + (c - '0');
+                if (mcumax.halfmove_clock > MCUMAX_HALFMOVE_DRAW)
+                    mcumax.halfmove_clock = MCUMAX_HALFMOVE_DRAW;
+            }
+
+            break;
+
+        case 5:
+            if ((c >= '0') && (c <= '9') &&
+                (mcumax.fullmove_number < 1000))
+                mcumax.fullmove_number = 10 * mcumax.fullmove_number + (c - '0');
+
+            break;
+        }
+    }
+
+    // No fullmove number
+    if (!mcumax.fullmove_number)
+        mcumax.fullmove_number = 1;
+
+#ifdef MCUMAX_BITBOARDS
+    mcumax_init_bitboards();
+#endif
+
+    mcumax_init_eval();
+    mcumax_init_king_squares();
+    mcumax_init_hash_keys();
+}
+
+mcumax_piece mcumax_get_current_side(void)
+{
+    return mcumax.current_side;
+}
+
+// Writes a number in decimal, returns the end
+static char *mcumax_write_number(char *p, uint16_t value)
+{
+    char digits[5];
+    uint8_t digits_num = 0;
+
+    do
+    {
+        digits[digits_num++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+
+    while (digits_num)
+        *p++ = digits[--digits_num];
+
+    return p;
+}
+
+void mcumax_get_fen_position(char *buffer, uint32_t buffer_size)
+{
+    static const char piece_chars[] = "?PPNKBRQ";
+
+    char fen[MCUMAX_FEN_SIZE];
+    char *p = fen;
+
+    // Board
+    for (uint8_t square = 0; square < 0x80; square += 0x10)
+    {
+        uint8_t empty_num = 0;
+
+        for (uint8_t x = 0; x < 8; x++)
+        {
+            uint8_t piece = mcumax.board[square + x];
+
+            if (!(piece & 0b111))
+                empty_num++;
+            else
+            {
+                if (empty_num)
+                    *p++ = '0' + empty_num;
+                empty_num = 0;
+
+                *p++ = piece_chars[piece & 0b111] +
+                       ((piece & MCUMAX_BOARD_BLACK) ? 'a' - 'A' : 0);
+            }
+        }
+
+        if (empty_num)
+            *p++ = '0' + empty_num;
+
+        *p++ = (square < 0x70) ? '/' : ' ';
+    }
+
+    // Side
+    *p++ = (mcumax.current_side == MCUMAX_BOARD_WHITE) ? 'w' : 'b';
+    *p++ = ' ';
+
+    // Castling: unmoved king and rook
+    char *castling = p;
+
+    if (mcumax.board[0x74] == (MCUMAX_BOARD_WHITE | MCUMAX_KING))
+    {
+        if (mcumax.board[0x77] == (MCUMAX_BOARD_WHITE | MCUMAX_ROOK))
+            *p++ = 'K';
+        if (mcumax.board[0x70] == (MCUMAX_BOARD_WHITE | MCUMAX_ROOK))
+            *p++ = 'Q';
+    }
+
+    if (mcumax.board[0x04] == (MCUMAX_BOARD_BLACK | MCUMAX_KING))
+    {
+        if (mcumax.board[0x07] == (MCUMAX_BOARD_BLACK | MCUMAX_ROOK))
+            *p++ = 'k';
+        if (mcumax.board[0x00] == (MCUMAX_BOARD_BLACK | MCUMAX_ROOK))
+            *p++ = 'q';
+    }
+
+    if (p == castling)
+        *p++ = '-';
+    *p++ = ' ';
+
+    // En-passant: only after a pawn double step (also set after castling),
+    // and only if a pawn of the side to move can capture, so equal positions
+    // give equal FENs
+    uint8_t square = mcumax.en_passant_square;
+    uint8_t pawn_square = square ^ 16;
+    bool en_passant = false;
+
+    if (!(square & MCUMAX_BOARD_MASK) &&
+        !mcumax.board[square] &&
+        ((mcumax.board[pawn_square] & 0b111) < 3) &&
+        ((mcumax.board[pawn_square] & (MCUMAX_BOARD_WHITE | MCUMAX_BOARD_BLACK)) ==
+         (mcumax.current_side ^ 0x18)))
+    {
+        for (int8_t step = -1; step <= 1; step += 2)
+        {
+            uint8_t capturer_square = pawn_square + step;
+            uint8_t piece = mcumax.board[capturer_square];
+
+            if (!(capturer_square & MCUMAX_BOARD_MASK) &&
+                (piece & 0b111) &&
+                ((piece & 0b111) < 3) &&
+                (piece & mcumax.current_side))
+                en_passant = true;
+        }
+    }
+
+    if (en_passant)
+    {
+        *p++ = 'a' + (square & 0b111);
+        *p++ = '8' - (square >> 4);
+    }
+    else
+        *p++ = '-';
+
+    // Clocks
+    *p++ = ' ';
+    p = mcumax_write_number(p, mcumax.halfmove_clock);
+    *p++ = ' ';
+    p = mcumax_write_number(p, mcumax.fullmove_number);
+    *p = '\0';
+
+    if (buffer_size)
+    {
+        uint32_t i = 0;
+        for (; (i < buffer_size - 1) && fen[i]; i++)
+            buffer[i] = fen[i];
+        buffer[i] = '\0';
+    }
+}
+
+static void mcumax_begin_search(enum mcumax_mode mode,
+                                mcumax_move move,
+                                uint32_t depth_max,
+                                uint32_t node_max)
+{
+    mcumax.square_from = move.from;
+    mcumax.square_to = move.to;
+
+    mcumax.node_max = node_max;
+    mcumax.node_count = 0;
+    mcumax.depth_max = (depth_max < MCUMAX_DEPTH_MAX) ? depth_max : MCUMAX_DEPTH_MAX;
+
+    mcumax.stop_search = false;
+
+    mcumax.best_move = MCUMAX_MOVE_INVALID;
+    mcumax.best_move_depth = 0;
+    mcumax.multipv_pass = 0;
+
+    memset(mcumax.killer_moves, 0, sizeof(mcumax.killer_moves));
+    mcumax.null_move_ply_min = 0;
+
+#ifdef MCUMAX_HASHING_ENABLED
+    // One generation per game search; move listing and playing don't age
+    if (mode == MCUMAX_SEARCH_BEST_MOVE)
+        mcumax_hash_next_generation();
+#endif
+
+    // Root node
+    struct mcumax_node *node = &mcumax.stack[0];
+
+    node->alpha = -MCUMAX_SCORE_MAX;
+    node->beta = MCUMAX_SCORE_MAX;
+    node->score = mcumax.score;
+    node->en_passant_square = mcumax.en_passant_square;
+    node->depth = 3;
+    node->mode = mode;
+    node->state = MCUMAX_NODE_ENTER;
+
+#ifdef MCUMAX_TRACE
+    node->trace_flags = 0;
+#endif
+
+    mcumax.ply = 0;
+    mcumax.search_done = false;
+}
+
+static mcumax_score mcumax_start_search(enum mcumax_mode mode,
+                                        mcumax_move move,
+                                        uint32_t depth_max,
+                                        uint32_t node_max)
+{
+    mcumax_begin_search(mode, move, depth_max, node_max);
+
+    mcumax.search_done = mcumax_search(UINT32_MAX);
+
+    return mcumax.search_score;
+}
+
+uint32_t mcumax_search_valid_moves(mcumax_move *valid_moves_buffer, uint32_t valid_moves_buffer_size)
+{
+    mcumax.valid_moves_num = 0;
+    mcumax.valid_moves_buffer = valid_moves_buffer;
+    mcumax.valid_moves_buffer_size = valid_moves_buffer_size;
+
+    mcumax_start_search(MCUMAX_SEARCH_VALID_MOVES, MCUMAX_MOVE_INVALID, 0, 0);
+
+    return mcumax.valid_moves_num;
+}
+
+// Fills the root move list for a best-move search: the search moves if set, else all valid moves
+static void mcumax_init_root_moves(void)
+{
+#ifdef MCUMAX_ROOT_MOVES
+    const mcumax_move *search_moves = mcumax.search_moves;
+    uint32_t search_moves_num = mcumax.search_moves_num;
+
+    mcumax.search_moves = NULL;
+    mcumax.search_moves_num = 0;
+
+    mcumax.root_moves_num = 0;
+    mcumax.root_moves_restricted = search_moves;
+
+    if (search_moves)
+    {
+        mcumax.root_moves_num = (search_moves_num < MCUMAX_ROOT_MOVES_MAX)
+                                    ? search_moves_num
+                                    : MCUMAX_ROOT_MOVES_MAX;
+        memcpy(mcumax.root_moves, search_moves, mcumax.root_moves_num * sizeof(mcumax_move));
+    }
+    else
+    {
+        uint32_t valid_moves_num = mcumax_search_valid_moves(mcumax.root_moves, MCUMAX_ROOT_MOVES_MAX);
+
+        // Too many: scan board instead
+        if (valid_moves_num <= MCUMAX_ROOT_MOVES_MAX)
+            mcumax.root_moves_num = valid_moves_num;
+    }
+
+    memset(mcumax.root_move_node_counts, 0, sizeof(mcumax.root_move_node_counts));
+
+    for (uint32_t i = 0; i < MCUMAX_ROOT_MOVES_MAX; i++)
+        mcumax.root_move_scores[i] = -MCUMAX_SCORE_MAX;
+#endif
+}
+
+mcumax_move mcumax_search_best_move(uint32_t node_max, uint32_t depth_max)
+{
+    mcumax_init_root_moves();
+    mcumax_start_search(MCUMAX_SEARCH_BEST_MOVE,
+                        MCUMAX_MOVE_INVALID, depth_max + 3, node_max);
+
+    return mcumax_search_result();
+}
+
+uint32_t mcumax_search_best_moves(mcumax_scored_move *buffer,
+                                  uint32_t buffer_size,
+                                  uint32_t node_max,
+                                  uint32_t depth_max)
+{
+    mcumax.multipv_buffer = buffer;
+    mcumax.multipv_buffer_size = buffer_size;
+    mcumax.multipv_num = 0;
+
+    mcumax_init_root_moves();
+    mcumax_start_search(MCUMAX_SEARCH_BEST_MOVE,
+                        MCUMAX_MOVE_INVALID, depth_max + 3, node_max);
+
+    mcumax.multipv_buffer_size = 0;
+
+    return mcumax.multipv_num;
+}
+
+#ifdef MCUMAX_ROOT_MOVES
+uint32_t mcumax_score_root_moves(mcumax_scored_move *buffer,
+                                 uint32_t buffer_size,
+                                 uint32_t node_max,
+                                 uint32_t depth_max)
+{
+    mcumax.root_scores_buffer = buffer;
+    mcumax.root_scores_buffer_size = buffer_size;
+    mcumax.root_scores_num = 0;
+
+    mcumax_init_root_moves();
+    mcumax_start_search(MCUMAX_SEARCH_BEST_MOVE,
+                        MCUMAX_MOVE_INVALID, depth_max + 3, node_max);
+
+    mcumax.root_scores_buffer_size = 0;
+
+    return mcumax.root_scores_num;
+}
+#endif
+
+void mcumax_search_begin(uint32_t node_max, uint32_t depth_max)
+{
+    mcumax_init_root_moves();
+    mcumax_begin_search(MCUMAX_SEARCH_BEST_MOVE,
+                        MCUMAX_MOVE_INVALID, depth_max + 3, node_max);
+}
+
+bool mcumax_search_step(uint32_t node_budget)
+{
+    if (mcumax.search_done)
+        return true;
+
+    // Always make progress
+    if (!node_budget)
+        node_budget = 1;
+
+    uint32_t node_limit = mcumax.node_count + node_budget;
+    if (node_limit < mcumax.node_count)
+        node_limit = UINT32_MAX;
+
+    mcumax.search_done = mcumax_search(node_limit);
+
+    return mcumax.search_done;
+}
+
+mcumax_move mcumax_search_result(void)
+{
+    if (mcumax.search_done &&
+        (mcumax.search_score == MCUMAX_SCORE_MAX))
+        return (mcumax_move){mcumax.square_from, mcumax.square_to};
+    else
+        return mcumax.best_move;
+}
+
+uint32_t mcumax_get_node_count(void)
+{
+    return mcumax.node_count;
+}
+
+uint32_t mcumax_get_search_depth(void)
+{
+    return mcumax.best_move_depth;
+}
+
+bool mcumax_play_move(mcumax_move move)
+{
+    if (mcumax_start_search(MCUMAX_PLAY_MOVE, move, 0, 0) != MCUMAX_SCORE_MAX)
+        return false;
+
+    // Score from board, incl. piece-square tables and pawn structure
+    mcumax_init_eval();
+
+    return true;
+}
+
+#ifdef MCUMAX_MATE_SEARCH
+// Mate search: proof-number search tree, in the caller's arena. Children of
+// a node are stored together; OR nodes (attacker to move) at even plies
+struct mcumax_mate_node
+{
+    uint32_t proof;    // Leaves to prove the mate
+    uint32_t disproof; // Leaves to refute it
+    uint32_t parent;
+    uint32_t children; // First child (0: not expanded)
+    mcumax_move move;
+    uint8_t children_num;
+};
+
+#define MCUMAX_MATE_INFINITY UINT32_MAX
+
+// Position without and with the history: listing and playing moves do not
+// read the history, so only the root copy keeps it
+#define MCUMAX_POSITION_SIZE \
+    (offsetof(struct mcumax_state, history_keys) - offsetof(struct mcumax_state, board))
+#define MCUMAX_GAME_SIZE (MCUMAX_POSITION_SIZE + sizeof(mcumax.history_keys))
+
+static uint32_t mcumax_mate_add(uint32_t a, uint32_t b)
+{
+    return (a > MCUMAX_MATE_INFINITY - b) ? MCUMAX_MATE_INFINITY : a + b;
+}
+
+static void mcumax_mate_update(struct mcumax_mate_node *nodes, uint32_t index, bool or_node)
+{
+    struct mcumax_mate_node *node = &nodes[index];
+    struct mcumax_mate_node *child = &nodes[node->children];
+
+    uint32_t proof = or_node ? MCUMAX_MATE_INFINITY : 0;
+    uint32_t disproof = or_node ? 0 : MCUMAX_MATE_INFINITY;
+
+    for (uint32_t i = 0; i < node->children_num; i++, child++)
+    {
+        if (or_node)
+        {
+            if (child->proof < proof)
+                proof = child->proof;
+            disproof = mcumax_mate_add(disproof, child->disproof);
+        }
+        else
+        {
+            proof = mcumax_mate_add(proof, child->proof);
+            if (child->disproof < disproof)
+                disproof = child->disproof;
+        }
+    }
+
+    node->proof = proof;
+    node->disproof = disproof;
+}
+
+// Adds the children of a leaf, scored by their number of replies
+static bool mcumax_mate_expand(struct mcumax_mate_node *nodes,
+                               uint32_t nodes_max,
+                               uint32_t *nodes_num,
+                               uint32_t index,
+                               uint32_t ply,
+                               uint32_t ply_max)
+{
+    // Moves are listed into the free arena, where their children go; children
+    // are filled last to first, each overwriting only moves already read
+    uint32_t children = *nodes_num;
+    mcumax_move *moves = (mcumax_move *)&nodes[children];
+    uint32_t moves_num = mcumax_search_valid_moves(moves,
+                                                   (nodes_max - children) *
+                                                       (sizeof(struct mcumax_mate_node) / sizeof(mcumax_move)));
+
+    if (moves_num > (nodes_max - children))
+        return false;
+
+    struct mcumax_mate_node *node = &nodes[index];
+    node->children = children;
+    node->children_num = moves_num;
+    *nodes_num += moves_num;
+
+    uint8_t position[MCUMAX_POSITION_SIZE];
+    memcpy(position, mcumax.board, MCUMAX_POSITION_SIZE);
+
+    for (uint32_t i = moves_num; i--;)
+    {
+        mcumax_move move = moves[i];
+        struct mcumax_mate_node *child = &nodes[children + i];
+
+        child->parent = index;
+        child->children = 0;
+        child->children_num = 0;
+        child->move = move;
+
+        mcumax_play_move(move);
+
+        uint32_t replies = mcumax_search_valid_moves(NULL, 0);
+        bool attacker_moved = !(ply & 1);
+        bool mated = !replies &&
+                     mcumax_is_square_attacked(mcumax.king_squares[mcumax.current_side >> 4],
+                                               mcumax.current_side ^ 0x18);
+
+        if (attacker_moved && mated)
+        {
+            child->proof = 0;
+            child->disproof = MCUMAX_MATE_INFINITY;
+        }
+        else if (!replies ||
+                 (attacker_moved && (ply + 1 >= ply_max)))
+        {
+            // Stalemate, attacker mated or stalemated, or out of moves
+            child->proof = MCUMAX_MATE_INFINITY;
+            child->disproof = 0;
+        }
+        else
+        {
+            // Attacker must refute all replies, defender needs one
+            child->proof = attacker_moved ? replies : 1;
+            child->disproof = attacker_moved ? 1 : replies;
+        }
+
+        memcpy(mcumax.board, position, MCUMAX_POSITION_SIZE);
+    }
+
+    return true;
+}
+
+// Plies to mate in a proven subtree: attacker's shortest, defender's longest
+static uint32_t mcumax_mate_distance(const struct mcumax_mate_node *nodes,
+                                     uint32_t index,
+                                     bool or_node,
+                                     uint32_t *best_child)
+{
+    const struct mcumax_mate_node *node = &nodes[index];
+
+    // Defender mated
+    if (!node->children)
+        return 0;
+
+    uint32_t best_distance = or_node ? MCUMAX_MATE_INFINITY : 0;
+
+    for (uint32_t i = node->children; i < node->children + node->children_num; i++)
+    {
+        if (nodes[i].proof)
+            continue;
+
+        uint32_t distance = 1 + mcumax_mate_distance(nodes, i, !or_node, NULL);
+
+        if (or_node ? (distance < best_distance) : (distance > best_distance))
+        {
+            best_distance = distance;
+            if (best_child)
+                *best_child = i;
+        }
+    }
+
+    return best_distance;
+}
+
+uint32_t mcumax_search_mate(mcumax_move *buffer,
+                            uint32_t buffer_size,
+                            uint32_t mate_moves,
+                            uint32_t node_max,
+                            void *arena,
+                            uint32_t arena_size)
+{
+    for (uint32_t i = 0; i < buffer_size; i++)
+        buffer[i] = MCUMAX_MOVE_INVALID;
+
+    if (!mate_moves)
+        return MCUMAX_MATE_NONE;
+    if (arena_size < MCUMAX_GAME_SIZE)
+        return MCUMAX_MATE_UNKNOWN;
+
+    // Root position at the arena end, tree at the start
+    uint8_t *root_position = (uint8_t *)arena + arena_size - MCUMAX_GAME_SIZE;
+    memcpy(root_position, mcumax.board, MCUMAX_GAME_SIZE);
+
+    struct mcumax_mate_node *nodes = arena;
+    uint32_t nodes_max = (arena_size - MCUMAX_GAME_SIZE) / sizeof(struct mcumax_mate_node);
+    uint32_t nodes_num = 1;
+
+    if (!nodes_max)
+        return MCUMAX_MATE_UNKNOWN;
+
+    nodes[0] = (struct mcumax_mate_node){1, 1, 0, 0, MCUMAX_MOVE_INVALID, 0};
+
+    // Listing and playing moves are searches: no callback within them
+    mcumax_callback user_callback = mcumax.user_callback;
+    mcumax.user_callback = NULL;
+
+    uint32_t ply_max = 2 * mate_moves - 1;
+    uint32_t expansions = 0;
+    bool stopped = false;
+
+    while (nodes[0].proof &&
+           nodes[0].disproof &&
+           (expansions < node_max) &&
+           !stopped)
+    {
+        // Most-proving node
+        uint32_t index = 0;
+        uint32_t ply = 0;
+
+        while (nodes[index].children)
+        {
+            struct mcumax_mate_node *node = &nodes[index];
+            uint32_t best = node->children;
+
+            for (uint32_t i = node->children; i < node->children + node->children_num; i++)
+            {
+                if (!(ply & 1) ? (nodes[i].proof < nodes[best].proof)
+                               : (nodes[i].disproof < nodes[best].disproof))
+                    best = i;
+            }
+
+            mcumax_play_move(nodes[best].move);
+            index = best;
+            ply++;
+        }
 
-    return (mcumax.board[square] & 0xf) ^ MCUMAX_BLACK;
-}
+        bool expanded = mcumax_mate_expand(nodes, nodes_max, &nodes_num,
+                                           index, ply, ply_max);
 
-void mcumax_set_fen_position(const char *fen_string)
-{
-    mcumax_init();
+        memcpy(mcumax.board, root_position, MCUMAX_POSITION_SIZE);
 
-    uint32_t field_index = 0;
-    uint32_t board_index = 0;
+        // Arena full
+        if (!expanded)
+            break;
 
-    char c;
-    while ((c = *fen_string++))
-    {
-        if (c == ' ')
+        expansions++;
+
+        for (;;)
         {
-            if (field_index < 4)
-                field_index++;
+            mcumax_mate_update(nodes, index, !(ply & 1));
 
-            continue;
+            if (!index)
+                break;
+
+            index = nodes[index].parent;
+            ply--;
         }
 
-        switch (field_index)
+        if (user_callback)
         {
-        case 0:
-            if (board_index < 0x80)
-            {
-                switch (c)
-                {
-                case '8':
-                case '7':
-                case '6':
-                case '5':
-                case '4':
-                case '3':
-                case '2':
-                case '1':
-                    for (int32_t i = 0; i < (c - '0'); i++)
-                        board_index = mcumax_set_piece(board_index, MCUMAX_EMPTY);
+            mcumax.stop_search = false;
+            user_callback(mcumax.user_data);
+            stopped = mcumax.stop_search;
+        }
+    }
 
-                    break;
+    memcpy(mcumax.board, root_position, MCUMAX_GAME_SIZE);
 
-                case 'P':
-                    board_index = mcumax_set_piece(board_index, MCUMAX_PAWN_UPSTREAM | MCUMAX_BOARD_WHITE);
+    mcumax.user_callback = user_callback;
+    mcumax.node_count = expansions;
 
-                    break;
+    if (nodes[0].disproof == 0)
+        return MCUMAX_MATE_NONE;
+    if (nodes[0].proof != 0)
+        return MCUMAX_MATE_UNKNOWN;
 
-                case 'N':
-                    board_index = mcumax_set_piece(board_index, MCUMAX_KNIGHT | MCUMAX_BOARD_WHITE);
+    // Mating line
+    uint32_t index = 0;
 
-                    break;
+    for (uint32_t i = 0; nodes[index].children; i++)
+    {
+        mcumax_mate_distance(nodes, index, !(i & 1), &index);
 
-                case 'B':
-                    board_index = mcumax_set_piece(board_index, MCUMAX_BISHOP | MCUMAX_BOARD_WHITE);
+        if (i < buffer_size)
+            buffer[i] = nodes[index].move;
+    }
 
-                    break;
+    return MCUMAX_MATE_FOUND;
+}
+#endif
 
-                case 'R':
-                    board_index = mcumax_set_piece(board_index, MCUMAX_ROOK | MCUMAX_BOARD_WHITE);
+#ifdef MCUMAX_EVAL_API
+void mcumax_get_eval_params(mcumax_eval_params *params)
+{
+    memcpy(params->piece_values, mcumax_piece_values, sizeof(params->piece_values));
 
-                    break;
+    for (uint8_t piece = 0; piece < 6; piece++)
+    {
+        for (uint8_t index = 0; index < 64; index++)
+        {
+            params->pst_mg[piece][index] = mcumax_pst_mg[piece][MCUMAX_PST_SQUARE(index)];
+            params->pst_eg[piece][index] = mcumax_pst_eg[piece][MCUMAX_PST_SQUARE(index)];
+        }
+    }
 
-                case 'Q':
-                    board_index = mcumax_set_piece(board_index, MCUMAX_QUEEN | MCUMAX_BOARD_WHITE);
+    params->pawn_doubled_mg = MCUMAX_PAWN_DOUBLED_MG;
+    params->pawn_doubled_eg = MCUMAX_PAWN_DOUBLED_EG;
+    params->pawn_isolated_mg = MCUMAX_PAWN_ISOLATED_MG;
+    params->pawn_isolated_eg = MCUMAX_PAWN_ISOLATED_EG;
 
-                    break;
+    for (uint8_t row = 0; row < 8; row++)
+    {
+        params->pawn_passed_mg[row] = mcumax_pawn_passed_mg[row];
+        params->pawn_passed_eg[row] = mcumax_pawn_passed_eg[row];
+    }
 
-                case 'K':
-                    board_index = mcumax_set_piece(board_index, MCUMAX_KING | MCUMAX_BOARD_WHITE);
+    for (uint8_t shelter = 0; shelter < 3; shelter++)
+        params->king_shelter_mg[shelter] = mcumax_king_shelter_mg[shelter];
+}
 
-                    break;
+void mcumax_get_eval_position(mcumax_eval_position *position)
+{
+    memcpy(position->board, mcumax.board, sizeof(position->board));
+    position->side = mcumax.current_side;
+}
 
-                case 'p':
-                    board_index = mcumax_set_piece(board_index, MCUMAX_PAWN_DOWNSTREAM | MCUMAX_BOARD_BLACK);
+int32_t mcumax_evaluate(const mcumax_eval_position *position,
+                        const mcumax_eval_params *params)
+{
+    const uint8_t *board = position->board;
+    int32_t material = 0;
+    int32_t eval_mg = 0;
+    int32_t eval_eg = 0;
+    uint8_t phase = 0;
+
+    // As mcumax_init_eval()
+    for (uint8_t square = 0; square < 0x80; square++)
+    {
+        uint8_t piece = board[square];
+        uint8_t type = piece & 0b111;
 
-                    break;
+        if ((square & MCUMAX_BOARD_MASK) || !type)
+            continue;
 
-                case 'n':
-                    board_index = mcumax_set_piece(board_index, MCUMAX_KNIGHT | MCUMAX_BOARD_BLACK);
+        bool black = piece & MCUMAX_BOARD_BLACK;
+        uint8_t index = MCUMAX_SQUARE_INDEX(black ? (square ^ 0x70) : square);
+        int32_t mg = params->pst_mg[MCUMAX_PST_PIECE(type)][index];
+        int32_t eg = params->pst_eg[MCUMAX_PST_PIECE(type)][index];
 
-                    break;
+        eval_mg += black ? -mg : mg;
+        eval_eg += black ? -eg : eg;
+        phase += mcumax_phase_weights[type];
 
-                case 'b':
-                    board_index = mcumax_set_piece(board_index, MCUMAX_BISHOP | MCUMAX_BOARD_BLACK);
+        if (type != MCUMAX_KING)
+            material += (piece & position->side)
+                            ? params->piece_values[type]
+                            : -params->piece_values[type];
+    }
 
-                    break;
+    struct mcumax_pawn_features features;
+    mcumax_get_pawn_features(board, &features);
 
-                case 'r':
-                    board_index = mcumax_set_piece(board_index, MCUMAX_ROOK | MCUMAX_BOARD_BLACK);
+    for (uint8_t side = 0; side < 2; side++)
+    {
+        int32_t mg = features.doubled[side] * params->pawn_doubled_mg +
+                     features.isolated[side] * params->pawn_isolated_mg;
+        int32_t eg = features.doubled[side] * params->pawn_doubled_eg +
+                     features.isolated[side] * params->pawn_isolated_eg;
 
-                    break;
+        for (uint8_t row = 0; row < 8; row++)
+        {
+            mg += features.passed[side][row] * params->pawn_passed_mg[row];
+            eg += features.passed[side][row] * params->pawn_passed_eg[row];
+        }
 
-                case 'q':
-                    board_index = mcumax_set_piece(board_index, MCUMAX_QUEEN | MCUMAX_BOARD_BLACK);
+        for (uint8_t shelter = 0; shelter < 3; shelter++)
+            mg += features.shelter[side][shelter] * params->king_shelter_mg[shelter];
 
-                    break;
+        eval_mg += side ? -mg : mg;
+        eval_eg += side ? -eg : eg;
+    }
 
-                case 'k':
-                    board_index = mcumax_set_piece(board_index, MCUMAX_KING | MCUMAX_BOARD_BLACK);
+    // As mcumax_eval_blend()
+    if (phase > MCUMAX_PHASE_MAX)
+        phase = MCUMAX_PHASE_MAX;
 
-                    break;
+    int32_t eval = (eval_mg * phase + eval_eg * (MCUMAX_PHASE_MAX - phase)) /
+                   MCUMAX_PHASE_MAX;
 
-                case '/':
-                    board_index = (board_index < 0x80) ? (board_index & 0xf0) + 0x10 : board_index;
+    return material + ((position->side == MCUMAX_BOARD_WHITE) ? eval : -eval);
+}
 
-                    break;
-                }
-            }
-            break;
+// Quiescence search for tuning: captures (queen promotions) on a board copy,
+// pseudo-legal, king captures scoring MCUMAX_SCORE_MAX
+struct mcumax_eval_capture
+{
+    uint8_t square_from;
+    uint8_t square_to;
+    int16_t order; // MVV/LVA
+};
 
-        case 1:
-            switch (c)
-            {
-            case 'w':
-                mcumax.current_side = MCUMAX_BOARD_WHITE;
+#define MCUMAX_EVAL_CAPTURES_MAX 64
 
-                break;
+static int32_t mcumax_evaluate_captures(mcumax_eval_position *position,
+                                        const mcumax_eval_params *params,
+                                        int32_t alpha,
+                                        int32_t beta,
+                                        uint32_t depth)
+{
+    // Stand pat
+    int32_t best_score = mcumax_evaluate(position, params);
 
-            case 'b':
-                mcumax.current_side = MCUMAX_BOARD_BLACK;
+    if (!depth || (best_score >= beta))
+        return best_score;
+    if (best_score > alpha)
+        alpha = best_score;
 
-                break;
-            }
-            break;
+    uint8_t *board = position->board;
+    uint8_t side = position->side;
 
-        case 2:
-            switch (c)
-            {
-            case 'K':
-                mcumax.board[0x74] &= ~MCUMAX_PIECE_MOVED;
-                mcumax.board[0x77] &= ~MCUMAX_PIECE_MOVED;
+    struct mcumax_eval_capture captures[MCUMAX_EVAL_CAPTURES_MAX];
+    uint32_t captures_num = 0;
 
-                break;
+    for (uint8_t square_from = 0; square_from < 0x80; square_from++)
+    {
+        uint8_t piece = board[square_from];
+        uint8_t type = piece & 0b111;
 
-            case 'Q':
-                mcumax.board[0x74] &= ~MCUMAX_PIECE_MOVED;
-                mcumax.board[0x70] &= ~MCUMAX_PIECE_MOVED;
+        if ((square_from & MCUMAX_BOARD_MASK) || !(piece & side))
+            continue;
 
-                break;
+        // Step vectors: pawn 1-2, rook 4-5, king and queen 7-10, bishop 9-10,
+        // knight 12-15; each both ways, pawns forward only
+        static const uint8_t steps_first[] = {0, 1, 1, 12, 7, 9, 4, 7};
+        static const uint8_t steps_last[] = {0, 2, 2, 15, 10, 10, 5, 10};
+        bool slider = (type >= MCUMAX_BISHOP);
 
-            case 'k':
-                mcumax.board[0x04] &= ~MCUMAX_PIECE_MOVED;
-                mcumax.board[0x07] &= ~MCUMAX_PIECE_MOVED;
+        for (uint8_t i = steps_first[type]; i <= steps_last[type]; i++)
+        {
+            for (uint8_t j = 0; j < 2; j++)
+            {
+                if ((type < 3) && (j != (type - 1)))
+                    continue;
+
+                int8_t step = j ? -mcumax_step_vectors[i] : mcumax_step_vectors[i];
+                uint8_t square_to = square_from;
+
+                do
+                    square_to += step;
+                while (slider &&
+                       !(square_to & MCUMAX_BOARD_MASK) &&
+                       !board[square_to]);
+
+                uint8_t capture_piece = board[square_to & 0x7f];
+
+                if ((square_to & MCUMAX_BOARD_MASK) ||
+                    !(capture_piece & (side ^ 0x18)) ||
+                    (captures_num == MCUMAX_EVAL_CAPTURES_MAX))
+                    continue;
+
+                captures[captures_num++] = (struct mcumax_eval_capture){
+                    square_from,
+                    square_to,
+                    mcumax_piece_values[capture_piece & 0b111] * 8 - type,
+                };
+            }
+        }
+    }
 
-                break;
+    for (uint32_t i = 0; i < captures_num; i++)
+    {
+        // Best remaining capture first
+        for (uint32_t j = i + 1; j < captures_num; j++)
+        {
+            if (captures[j].order > captures[i].order)
+            {
+                struct mcumax_eval_capture capture = captures[i];
+                captures[i] = captures[j];
+                captures[j] = capture;
+            }
+        }
 
-            case 'q':
-                mcumax.board[0x04] &= ~MCUMAX_PIECE_MOVED;
-                mcumax.board[0x00] &= ~MCUMAX_PIECE_MOVED;
+        uint8_t square_from = captures[i].square_from;
+        uint8_t square_to = captures[i].square_to;
+        uint8_t piece = board[square_from];
+        uint8_t capture_piece = board[square_to];
 
-                break;
-            }
+        if ((capture_piece & 0b111) == MCUMAX_KING)
+            return MCUMAX_SCORE_MAX;
 
-            break;
+        // Promotion: convert to queen
+        uint8_t type = piece & 0b111;
+        board[square_to] = ((type < 3) &&
+                            ((square_to >> 4) == ((type == MCUMAX_PAWN_UPSTREAM) ? 0 : 7)))
+                               ? piece + MCUMAX_QUEEN - type
+                               : piece;
+        board[square_from] = 0;
+        position->side ^= 0x18;
 
-        case 3:
-            switch (c)
-            {
-            case 'a':
-            case 'b':
-            case 'c':
-            case 'd':
-            case 'e':
-            case 'f':
-            case 'g':
-            case 'h':
-                mcumax.en_passant_square &= 0x7f;
-                mcumax.en_passant_square |= (c - 'a');
+        int32_t score = -mcumax_evaluate_captures(position, params, -beta, -alpha, depth - 1);
 
-                break;
+        position->side ^= 0x18;
+        board[square_from] = piece;
+        board[square_to] = capture_piece;
 
-            case '1':
-            case '2':
-            case '3':
-            case '4':
-            case '5':
-            case '6':
-            case '7':
-            case '8':
-                mcumax.en_passant_square &= 0x7f;
-                mcumax.en_passant_square |= 16 * ('8' - c);
+        if (score > best_score)
+        {
+            best_score = score;
 
+            if (score > alpha)
+                alpha = score;
+            if (alpha >= beta)
                 break;
-            }
-
-            break;
         }
     }
-}
 
-mcumax_piece mcumax_get_current_side(void)
-{
-    return mcumax.current_side;
+    return best_score;
 }
 
-static int32_t mcumax_start_search(enum mcumax_mode mode,
-                                   mcumax_move move,
-                                   uint32_t depth_max,
-                                   uint32_t node_max)
+int32_t mcumax_evaluate_quiescence(const mcumax_eval_position *position,
+                                   const mcumax_eval_params *params,
+                                   uint32_t depth_max)
 {
-    mcumax.square_from = move.from;
-    mcumax.square_to = move.to;
-
-    mcumax.node_max = node_max;
-    mcumax.node_count = 0;
-    mcumax.depth_max = depth_max;
+    mcumax_eval_position board = *position;
 
-    mcumax.stop_search = false;
-
-    return mcumax_search(-MCUMAX_SCORE_MAX,
-                         MCUMAX_SCORE_MAX,
-                         mcumax.score,
-                         mcumax.en_passant_square,
-                         3,
-                         mode);
+    return mcumax_evaluate_captures(&board, params,
+                                    -MCUMAX_SCORE_MAX, MCUMAX_SCORE_MAX, depth_max);
 }
+#endif
 
-uint32_t mcumax_search_valid_moves(mcumax_move *valid_moves_buffer, uint32_t valid_moves_buffer_size)
+#ifdef MCUMAX_ROOT_MOVES
+void mcumax_set_search_moves(const mcumax_move *moves, uint32_t moves_num)
 {
-    mcumax.valid_moves_num = 0;
-    mcumax.valid_moves_buffer = valid_moves_buffer;
-    mcumax.valid_moves_buffer_size = valid_moves_buffer_size;
-
-    mcumax_start_search(MCUMAX_SEARCH_VALID_MOVES, MCUMAX_MOVE_INVALID, 0, 0);
-
-    return mcumax.valid_moves_num;
+    mcumax.search_moves = moves;
+    mcumax.search_moves_num = moves_num;
 }
+#endif
 
-mcumax_move mcumax_search_best_move(uint32_t node_max, uint32_t depth_max)
+#ifdef MCUMAX_TRACE
+void mcumax_set_trace_buffer(mcumax_trace_record *buffer, uint32_t buffer_size)
 {
-    int32_t score = mcumax_start_search(MCUMAX_SEARCH_BEST_MOVE,
-                                        MCUMAX_MOVE_INVALID, depth_max + 3, node_max);
-
-    if (score == MCUMAX_SCORE_MAX)
-        return (mcumax_move){mcumax.square_from, mcumax.square_to};
-    else
-        return MCUMAX_MOVE_INVALID;
+    mcumax.trace_buffer = buffer;
+    mcumax.trace_buffer_size = buffer ? buffer_size : 0;
+    mcumax.trace_count = 0;
 }
 
-bool mcumax_play_move(mcumax_move move)
+uint32_t mcumax_get_trace_count(void)
 {
-    return mcumax_start_search(MCUMAX_PLAY_MOVE, move, 0, 0) == MCUMAX_SCORE_MAX;
+    return mcumax.trace_count;
 }
+#endif
 
 void mcumax_set_callback(mcumax_callback callback, void *userdata)
 {
@@ -920,3 +4095,130 @@ void mcumax_stop_search(void)
 {
     mcumax.stop_search = true;
 }
+
+void mcumax_clear_hash(void)
+{
+#ifdef MCUMAX_HASHING_ENABLED
+    memset(mcumax_hash_table, 0, sizeof(mcumax_hash_storage));
+#endif
+}
+
+#ifdef MCUMAX_HASH_FILES
+bool mcumax_save_hash(const char *path)
+{
+#ifdef MCUMAX_HASHING_ENABLED
+    struct HashFileHeader header;
+    mcumax_hash_file_header(&header);
+
+    // Write aside, then replace: the old file may still be mapped
+    char temp_path[256];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path))
+        return false;
+
+    FILE *file = fopen(temp_path, "wb");
+    if (!file)
+        return false;
+
+    bool ok = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+              (fwrite(mcumax_hash_table, sizeof(struct HashBucket), MCUMAX_HASH_BUCKET_NUM, file) ==
+               MCUMAX_HASH_BUCKET_NUM);
+    ok &= !fclose(file);
+
+#ifndef MCUMAX_HASH_MMAP
+    if (ok)
+        remove(path);
+#endif
+
+    if (!ok || rename(temp_path, path))
+    {
+        remove(temp_path);
+
+        return false;
+    }
+
+    return true;
+#else
+    (void)path;
+
+    return false;
+#endif
+}
+
+bool mcumax_load_hash(const char *path)
+{
+#ifdef MCUMAX_HASHING_ENABLED
+    struct HashFileHeader expected_header;
+    mcumax_hash_file_header(&expected_header);
+
+    struct HashFileHeader header;
+
+#ifdef MCUMAX_HASH_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    size_t map_size = sizeof(struct HashFileHeader) + sizeof(mcumax_hash_storage);
+
+    struct stat file_stat;
+    void *map = MAP_FAILED;
+    if (!fstat(fd, &file_stat) &&
+        ((size_t)file_stat.st_size == map_size))
+        map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0); // Copy on write
+    close(fd);
+
+    if (map == MAP_FAILED)
+        return false;
+
+    memcpy(&header, map, sizeof(header));
+    expected_header.generation = header.generation;
+    if (memcmp(&header, &expected_header, sizeof(header)))
+    {
+        munmap(map, map_size);
+
+        return false;
+    }
+
+    if (mcumax_hash_map)
+        munmap(mcumax_hash_map, mcumax_hash_map_size);
+    mcumax_hash_map = map;
+    mcumax_hash_map_size = map_size;
+
+    mcumax_hash_table = (struct HashBucket *)((uint8_t *)map + sizeof(header));
+#else
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+
+    bool ok = (fread(&header, sizeof(header), 1, file) == 1);
+    expected_header.generation = header.generation;
+    if (!ok || memcmp(&header, &expected_header, sizeof(header)))
+    {
+        fclose(file);
+
+        return false;
+    }
+
+    ok = (fread(mcumax_hash_table, sizeof(struct HashBucket), MCUMAX_HASH_BUCKET_NUM, file) ==
+          MCUMAX_HASH_BUCKET_NUM);
+    fclose(file);
+
+    if (!ok)
+    {
+        // Partly read: start cold
+        memset(mcumax_hash_table, 0, sizeof(mcumax_hash_storage));
+
+        return false;
+    }
+#endif
+
+    // Continue aging where the saved searches left off
+    mcumax_hash_generation = header.generation;
+
+    return true;
+#else
+    (void)path;
+
+    return false;
+#endif
+}
+#endif
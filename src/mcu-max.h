@@ -25,6 +25,10 @@ extern "C" {
 
 #define MCUMAX_SQUARE_INVALID 0x80
 
+#define MCUMAX_FEN_SIZE 100 // FEN buffer size
+
+#define MCUMAX_SCORE_MAX 8000 // Scores stay within +-MCUMAX_SCORE_MAX
+
 #define MCUMAX_MOVE_INVALID \
     (mcumax_move) { MCUMAX_SQUARE_INVALID, MCUMAX_SQUARE_INVALID }
 
@@ -37,8 +41,86 @@ typedef struct
     mcumax_square to;
 } mcumax_move;
 
+typedef struct
+{
+    mcumax_move move;
+    int32_t score;
+    uint32_t depth;
+} mcumax_scored_move;
+
 typedef void (*mcumax_callback)(void *);
 
+/**
+ * Search trace record: a node searched, written when it returns
+ */
+typedef struct
+{
+    uint32_t node_count; // Nodes searched so far
+    int16_t alpha;       // Window and score, from the node's side
+    int16_t beta;
+    int16_t score;
+    mcumax_move move; // Move leading to node (invalid: null move)
+    uint8_t ply;      // 0: root iteration
+    uint8_t depth;    // Remaining depth in plies
+    uint8_t flags;
+    uint8_t reserved;
+} mcumax_trace_record;
+
+/**
+ * Search trace record flags
+ */
+enum
+{
+    MCUMAX_TRACE_NULL_MOVE = 0x01,  // Null move search
+    MCUMAX_TRACE_VERIFY = 0x02,     // Null move verification search
+    MCUMAX_TRACE_REDUCED = 0x04,    // Late move reduction
+    MCUMAX_TRACE_RESEARCH = 0x08,   // Move searched again
+    MCUMAX_TRACE_HASH_CUT = 0x10,   // Score from hash table
+    MCUMAX_TRACE_QUIESCENCE = 0x20, // Horizon: quiescence search
+    MCUMAX_TRACE_DRAW = 0x40,       // Repetition or fifty moves
+};
+
+#ifdef MCUMAX_EVAL_API
+/**
+ * Evaluation parameters, for tuning: the evaluation tables, white's view,
+ * rank 8 first
+ */
+typedef struct
+{
+    int16_t piece_values[8]; // By piece type
+    int16_t pst_mg[6][64];   // Pawn, knight, king, bishop, rook, queen
+    int16_t pst_eg[6][64];
+    int16_t pawn_doubled_mg;
+    int16_t pawn_doubled_eg;
+    int16_t pawn_isolated_mg;
+    int16_t pawn_isolated_eg;
+    int16_t pawn_passed_mg[8]; // By row
+    int16_t pawn_passed_eg[8];
+    int16_t king_shelter_mg[3]; // By shield pawn distance (none, one, two rows)
+} mcumax_eval_params;
+
+/**
+ * Position for evaluation: a copy of the engine board
+ */
+typedef struct
+{
+    uint8_t board[0x80];
+    uint8_t side; // Side to move: 0x8 white, 0x10 black
+} mcumax_eval_position;
+#endif
+
+#ifdef MCUMAX_MATE_SEARCH
+/**
+ * Mate search results
+ */
+enum
+{
+    MCUMAX_MATE_UNKNOWN, // Node limit or arena reached
+    MCUMAX_MATE_FOUND,
+    MCUMAX_MATE_NONE, // No mate within the given moves
+};
+#endif
+
 /**
  * Piece types
  */
@@ -70,6 +152,14 @@ void mcumax_init(void);
  */
 void mcumax_set_fen_position(const char *value);
 
+/**
+ * @brief Gets the position as a FEN string.
+ *
+ * @param buffer A buffer for the FEN string (MCUMAX_FEN_SIZE bytes).
+ * @param buffer_size The buffer size.
+ */
+void mcumax_get_fen_position(char *buffer, uint32_t buffer_size);
+
 /**
  * @brief Returns the piece at the specified square.
  *
@@ -103,6 +193,161 @@ uint32_t mcumax_search_valid_moves(mcumax_move *buffer, uint32_t buffer_size);
  */
 mcumax_move mcumax_search_best_move(uint32_t node_max, uint32_t depth_max);
 
+/**
+ * @brief Searches the best moves (MultiPV). At each depth, the root is searched
+ * once per line, excluding the moves of the lines already found.
+ *
+ * @param buffer A buffer for storing the lines, best first.
+ * @param buffer_size The number of lines to search.
+ * @param node_max The maximum number of nodes to search.
+ * @param depth_max The maximum depth to search.
+ *
+ * @return The number of lines found.
+ */
+uint32_t mcumax_search_best_moves(mcumax_scored_move *buffer,
+                                  uint32_t buffer_size,
+                                  uint32_t node_max,
+                                  uint32_t depth_max);
+
+#ifdef MCUMAX_ROOT_MOVES
+/**
+ * @brief Scores every root move in one search: the root is searched with an
+ * open window, so each move gets an exact score at each depth. Requires
+ * MCUMAX_ROOT_MOVES.
+ *
+ * @param buffer A buffer for storing the scored moves, best first.
+ * @param buffer_size The buffer size.
+ * @param node_max The maximum number of nodes to search.
+ * @param depth_max The maximum depth to search.
+ *
+ * @return The number of moves scored (at most MCUMAX_ROOT_MOVES_MAX).
+ */
+uint32_t mcumax_score_root_moves(mcumax_scored_move *buffer,
+                                 uint32_t buffer_size,
+                                 uint32_t node_max,
+                                 uint32_t depth_max);
+#endif
+
+#ifdef MCUMAX_MATE_SEARCH
+/**
+ * @brief Searches a forced mate with proof-number search. The search tree is
+ * kept in the arena (20 bytes per node) after a copy of the root position
+ * (board and game history); the search ends when the mate is proven or
+ * refuted, or when the node limit or the arena is reached. Promotions are to
+ * queen only.
+ *
+ * @param buffer A buffer for storing the mating line, unused moves set to
+ * MCUMAX_MOVE_INVALID.
+ * @param buffer_size The buffer size.
+ * @param mate_moves The maximum number of moves of the attacker to mate.
+ * @param node_max The maximum number of nodes to expand.
+ * @param arena The memory for the search tree, 4-byte aligned.
+ * @param arena_size The arena size in bytes.
+ *
+ * @return MCUMAX_MATE_FOUND, MCUMAX_MATE_NONE or MCUMAX_MATE_UNKNOWN.
+ */
+uint32_t mcumax_search_mate(mcumax_move *buffer,
+                            uint32_t buffer_size,
+                            uint32_t mate_moves,
+                            uint32_t node_max,
+                            void *arena,
+                            uint32_t arena_size);
+#endif
+
+#ifdef MCUMAX_EVAL_API
+/**
+ * @brief Gets the evaluation parameters of the compiled evaluation tables.
+ *
+ * @param params The parameters.
+ */
+void mcumax_get_eval_params(mcumax_eval_params *params);
+
+/**
+ * @brief Gets the current position for evaluation.
+ *
+ * @param position The position.
+ */
+void mcumax_get_eval_position(mcumax_eval_position *position);
+
+/**
+ * @brief Evaluates a position statically with the given parameters. With the
+ * compiled parameters, this is the engine's static evaluation. Does not use
+ * the engine state, so may be called from several threads.
+ *
+ * @param position The position.
+ * @param params The parameters.
+ *
+ * @return The score, from the view of the side to move.
+ */
+int32_t mcumax_evaluate(const mcumax_eval_position *position,
+                        const mcumax_eval_params *params);
+
+/**
+ * @brief Evaluates a position with a short quiescence search: pseudo-legal
+ * captures with stand pat and MVV/LVA ordering. Does not use the engine
+ * state, so may be called from several threads.
+ *
+ * @param position The position.
+ * @param params The parameters.
+ * @param depth_max The maximum number of captures.
+ *
+ * @return The score, from the view of the side to move.
+ */
+int32_t mcumax_evaluate_quiescence(const mcumax_eval_position *position,
+                                   const mcumax_eval_params *params,
+                                   uint32_t depth_max);
+#endif
+
+/**
+ * @brief Begins a resumable best-move search. Run it with mcumax_search_step().
+ *
+ * No other engine function may be called until the search has finished.
+ *
+ * @param node_max The maximum number of nodes to search.
+ * @param depth_max The maximum depth to search.
+ */
+void mcumax_search_begin(uint32_t node_max, uint32_t depth_max);
+
+/**
+ * @brief Continues a search begun with mcumax_search_begin().
+ *
+ * @param node_budget The approximate number of nodes to search before returning.
+ *
+ * @return The search has finished.
+ */
+bool mcumax_search_step(uint32_t node_budget);
+
+/**
+ * @brief Returns the result of a search. While the search is running, or
+ * after it was stopped, returns the best move of the last completed iteration.
+ *
+ * @return The best move (MCUMAX_SQUARE_INVALID, MCUMAX_SQUARE_INVALID if none found).
+ */
+mcumax_move mcumax_search_result(void);
+
+/**
+ * @brief Returns the number of nodes searched by the last search.
+ */
+uint32_t mcumax_get_node_count(void);
+
+/**
+ * @brief Returns the depth of the last completed iteration of the last search,
+ * the depth of mcumax_search_result() (0 if none).
+ */
+uint32_t mcumax_get_search_depth(void);
+
+#ifdef MCUMAX_ROOT_MOVES
+/**
+ * @brief Restricts the root of the next best-move search to the given moves.
+ * The moves buffer must remain valid until that search begins. Requires
+ * MCUMAX_ROOT_MOVES.
+ *
+ * @param moves The moves (NULL for all valid moves).
+ * @param moves_num The number of moves.
+ */
+void mcumax_set_search_moves(const mcumax_move *moves, uint32_t moves_num);
+#endif
+
 /**
  * @brief Plays a move.
  *
@@ -111,6 +356,47 @@ mcumax_move mcumax_search_best_move(uint32_t node_max, uint32_t depth_max);
  */
 bool mcumax_play_move(mcumax_move move);
 
+/**
+ * @brief Clears the hash table, e.g. for reproducible searches.
+ */
+void mcumax_clear_hash(void);
+
+#ifdef MCUMAX_HASH_FILES
+/**
+ * @brief Saves the hash table to a file. Requires MCUMAX_HASHING_ENABLED.
+ *
+ * @param path The file path.
+ * @return The hash table was saved.
+ */
+bool mcumax_save_hash(const char *path);
+
+/**
+ * @brief Loads the hash table from a file saved by a build with the same hash
+ * configuration. Memory-mapped on POSIX hosts. Call after mcumax_init().
+ *
+ * @param path The file path.
+ * @return The hash table was loaded.
+ */
+bool mcumax_load_hash(const char *path);
+#endif
+
+#ifdef MCUMAX_TRACE
+/**
+ * @brief Sets the search trace buffer. Searches append records to it as a
+ * ring, overwriting the oldest. Requires MCUMAX_TRACE.
+ *
+ * @param buffer The buffer (NULL for no tracing).
+ * @param buffer_size The buffer size, in records.
+ */
+void mcumax_set_trace_buffer(mcumax_trace_record *buffer, uint32_t buffer_size);
+
+/**
+ * @brief Returns the number of records traced since the buffer was set. Once
+ * the buffer is full, the oldest record is at index count % buffer_size.
+ */
+uint32_t mcumax_get_trace_count(void);
+#endif
+
 /**
  * @brief Sets the user callback, which is called periodically during search.
  */